@@ -0,0 +1,44 @@
+/*
+ * bench.c - Optional worst-case cycle counters for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */ 
+
+#include <stdint.h>
+#include <util/atomic.h>
+#include "bench.h"
+
+#ifdef BENCH
+
+uint16_t bench_max[BENCH_NSLOTS];
+
+uint16_t bench_getmax(enum bench_slot slot) {
+	uint16_t r;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// slots are written from ISRs
+		r = bench_max[slot];
+	}
+	return r;
+}
+
+void bench_reset() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for(uint8_t i = 0; i < BENCH_NSLOTS; i++) {
+			bench_max[i] = 0;
+		}
+	}
+}
+
+#endif
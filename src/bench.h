@@ -0,0 +1,83 @@
+/*
+ * bench.h - Optional worst-case cycle counters for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Build with -DBENCH to record the longest run of each instrumented code
+ * path.  Timer1 runs unprescaled, so one count is one CPU cycle.  Without
+ * BENCH the macros compile to nothing.
+ */ 
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <avr/io.h>
+#include <stdint.h>
+
+enum bench_slot {
+	BENCH_REMISR,		// IR input capture interrupt
+	BENCH_TICKISR,		// tick interrupt, the part with interrupts disabled
+	BENCH_TICKWORK,		// tick interrupt, the display and pot work after it, with any interrupts that nest in it
+	BENCH_SIRC,			// SIRC decoder, per edge
+	BENCH_NEC,			// NEC decoder, per edge
+	BENCH_RC5,			// RC5 decoder, per edge
+	BENCH_VFDCOMMIT,	// handing a frame to the display transmitter
+	BENCH_VFDCLEAR,		// a full blocking display frame (vfd_clear), from an idle bus
+	BENCH_VFDPERBYTE,	// the same frame with bus setup for every byte, as before vfd_begin()
+	BENCH_FMT,			// formatting a setting with fmt.c
+	BENCH_PRINTF,		// formatting the same setting with snprintf_P
+	BENCH_POTXFER,		// a pot update, from queuing it until the pots have it
+	BENCH_NSLOTS
+};
+
+#ifdef BENCH
+
+extern uint16_t bench_max[BENCH_NSLOTS];
+
+// marks the start of a measured section; must be in the same scope as BENCH_END
+#define BENCH_BEGIN() uint16_t bench_t0 = TCNT1
+
+// records the cycles since BENCH_BEGIN() if they are a new worst case
+#define BENCH_END(slot) do { \
+		uint16_t bench_dt = TCNT1 - bench_t0; \
+		if(bench_dt > bench_max[slot]) bench_max[slot] = bench_dt; \
+	} while(0)
+
+/* the same across scopes, such as from queuing work to an interrupt
+   finishing it: BENCH_STAMP() stores the start in t0 and BENCH_SINCE()
+   records the cycles since then */
+#define BENCH_STAMP(t0) ((t0) = TCNT1)
+#define BENCH_SINCE(slot, t0) do { \
+		uint16_t bench_dt = TCNT1 - (t0); \
+		if(bench_dt > bench_max[slot]) bench_max[slot] = bench_dt; \
+	} while(0)
+
+// gets the worst case recorded for a slot, in CPU cycles
+uint16_t bench_getmax(enum bench_slot slot);
+
+// clears all recorded worst cases
+void bench_reset();
+
+#else
+
+#define BENCH_BEGIN()
+#define BENCH_END(slot)
+#define BENCH_STAMP(t0)
+#define BENCH_SINCE(slot, t0)
+
+#endif
+
+#endif /* BENCH_H_ */
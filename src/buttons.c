@@ -1,361 +1,244 @@
 /* butenc.c - overhauled human-interface logic 
- * Uses PCINT*/
+ * Buttons and encoders are sampled from the tick interrupt.  The IR
+ * receiver is handled by remote.c, which queues its events here. */
 
 #if F_CPU != 1000000UL
 #error "F_CPU must be 100000 Hz. Other CPU frequencies are not yet supported."
 #endif
 
 #include <avr/io.h>
-#include <util/delay.h>
 #include <stdint.h>
-#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "pins.h"
 #include "buttons.h"
 
-#define BUT_DEBTIME 10		// button debounce time, in milliseconds
-#define ENC_DEBTIME 20		// encoder debounce time, in 100 microseconds
-#define REM_TIMEOUT 40000U	// max time between remote packets, in microseconds
-#define REM_ADDRESS 1		// device address to listen for
+#define BUT_DEBTIME 8		// button debounce time, in milliseconds
+#define BUT_SAMPLETICKS (BUT_DEBTIME / 4)	// 2-bit counters need 4 agreeing samples
+#define BUT_HOLDTIME (1000 / BUT_SAMPLETICKS)	// samples before a held button is reported
+#define BUT_HOLDUNIT (100 / BUT_SAMPLETICKS)	// samples per release hold-time unit (0.1 s)
+#define BUT_MAXHOLD (BUT_MAXSTEPS * BUT_HOLDUNIT)	// hold timer saturates here
+#define ENC_N 2				// number of encoders
+#define ENC_DETENT 3		// encoder state at rest (both contacts open)
+#define ENC_MINBLIPS 2		// transitions needed between detents to count a step
+#define ENC_NACCEL 3		// entries in the acceleration curve
 
-static uint8_t gray2num(uint8_t g);	// converts graycode to uint8_t
-static void but_check();	// checks for presses and updates but_outstanding
-static void enc_check();	// checks for turning and updates but_outstanding
-static void rem_check();	// checks for presses and updates but_outstanding
+static void but_debounce(uint8_t pins);	// queues debounced button changes
+static uint8_t enc_steps(uint8_t i);	// applies acceleration to a detent
 
-static enum but_type but_outstanding = BUT_NONE;
+/*
+ * Input event queue.
+ * Interrupts (tick and IR receiver, which never nest) are the only producers and the UI loop is the only consumer,
+ * so the indices need no locking: but_qhead is only written by but_push()
+ * and but_qtail only by the pop functions.  Both run freely and are masked
+ * on access; their difference is the number of queued events.
+ */
+static volatile struct but_event but_queue[BUT_QLEN];
+static volatile uint8_t but_qhead = 0;	// next slot to fill
+static volatile uint8_t but_qtail = 0;	// oldest queued event
+
+/*
+ * Quadrature transition table, indexed by (last state << 2) | new state.
+ * Each state is (B<<1)|A.  Forward is 3-2-0-1-3; impossible jumps
+ * (both contacts changing in one sample) count as no motion.
+ */
+static const int8_t PROGMEM enc_table[16] = {
+	 0,  1, -1,  0,
+	-1,  0,  0,  1,
+	 1,  0,  0, -1,
+	 0, -1,  1,  0
+};
+
+// PINC bit of each encoder's A contact (its B contact is the next bit up)
+static const uint8_t PROGMEM enc_shift[ENC_N] = {PINC_VOLUP, PINC_LEFT};
+
+// events for a forward and backward detent of each encoder
+static const uint8_t PROGMEM enc_events[ENC_N][2] = {
+	{BUT_VOLINC, BUT_VOLDEC},
+	{BUT_SELUPL, BUT_SELDNR}
+};
+
+// encoders whose detents speed up when turned quickly
+static const uint8_t PROGMEM enc_accelerated[ENC_N] = {1, 0};
+
+/*
+ * Acceleration curve, fastest first: a detent less than ms milliseconds
+ * after the previous one counts as steps steps.  Slower detents count as 1.
+ */
+static const struct {
+	uint8_t ms;
+	uint8_t steps;
+} PROGMEM enc_accel[ENC_NACCEL] = {
+	{20, 4},
+	{40, 3},
+	{80, 2}
+};
+
+// encoder state, touched only by the tick interrupt
+static uint8_t enc_state[ENC_N];	// last 2-bit state
+static int8_t enc_blips[ENC_N];		// transitions since the last detent
+static uint8_t enc_idle[ENC_N];		// ticks since the last detent (saturates)
+
+// button state, touched only by the tick interrupt
+static uint8_t but_divider = BUT_SAMPLETICKS;	// ticks until the next sample
+static uint8_t but_state = 0;		// debounced buttons, 1 = pressed
+static uint8_t but_cnt0 = 0xff;		// low bits of the vertical counters
+static uint8_t but_cnt1 = 0xff;		// high bits of the vertical counters
+static uint16_t but_holdtime = 0;	// samples since the last press
 
 void butinit() {
-	DDRB &= ~(1<<REM_RX);			// make sure IR receiver is input
-	PORTB |= 1<<REM_RX;				// enable pullup
 	DDRC &= ~(PINC_BUTMASK|PINC_ENCMASK);	// make sure all buttons are inputs
 	PORTC |= PINC_BUTMASK|PINC_ENCMASK;		// inputs with pullups, that is
 	
-	TCCR1A = 0;						// Ensure timer is in 'normal' mode
-	TCCR1B |= (1<<ICNC1)|(0<<ICES1)|(1<<CS10);	// Detect falling edge (start of timing), max count rate
-	TIMSK1 = 0;
-	
-	PCICR |= 1<<PCIE1;				// enable pin-change interrupt
-	PCMSK1 |= PCI1_MASK;			// and enable each button interrupt
-	TIMSK1 |= 1<<ICIE1;				// Enable input compare interrupt for remote receiver
+	for(uint8_t i = 0; i < ENC_N; i++) {	// start encoders from where they rest
+		enc_state[i] = (PINC >> pgm_read_byte(&enc_shift[i])) & 0x03;
+	}
 }
 
 enum but_type but_pop() {
-	enum but_type os = but_outstanding;
-	but_outstanding = BUT_NONE;
-	return os;
+	volatile struct but_event * ev;
+	enum but_type type;
+	
+	if(but_qhead == but_qtail) return BUT_NONE;
+	
+	ev = &but_queue[but_qtail & (BUT_QLEN - 1)];
+	type = ev->type;
+	LAT_DISPATCH(ev->stamp);
+	if(ev->count > 1) {
+		ev->count--;			// leave the remaining steps queued
+	} else {
+		but_qtail++;
+	}
+	return type;
+}
+
+enum but_type but_popn(uint8_t * steps) {
+	volatile struct but_event * ev;
+	enum but_type type;
+	
+	if(but_qhead == but_qtail) {
+		*steps = 0;
+		return BUT_NONE;
+	}
+	
+	ev = &but_queue[but_qtail & (BUT_QLEN - 1)];
+	type = ev->type;
+	*steps = ev->count;
+	LAT_DISPATCH(ev->stamp);
+	but_qtail++;
+	return type;
 }
 
 enum but_type but_peek() {
-	return but_outstanding;
+	if(but_qhead == but_qtail) return BUT_NONE;
+	return but_queue[but_qtail & (BUT_QLEN - 1)].type;
 }
 
-// processes any encoder movement
-static void enc_check() {
-	static int8_t volblips = 0;	// 4 blips = 1 detent/buttonpress
-	static int8_t selblips = 0;
-	static uint8_t old_volpos = 4;	// 4 is sentinel value
-	static uint8_t old_selpos = 4;
-	uint8_t pincstore = PINC;
-	uint8_t cur_volpos, cur_selpos, debounce_time;
+void but_push(enum but_type type) {
+	but_pushn(type, 1);
+}
+
+/*
+ * Repeated encoder-style events are merged into the newest queued event,
+ * but only when that event is not also the oldest one, which the consumer
+ * may be reading.
+ */
+void but_pushn(enum but_type type, uint8_t steps) {
+	uint8_t head = but_qhead;
+	uint8_t queued = head - but_qtail;
+	volatile struct but_event * last = &but_queue[(head - 1) & (BUT_QLEN - 1)];
 	
-	// on debounce
-	debounce_time = ENC_DEBTIME;
-	while(debounce_time > 0) {
-		if(pincstore != PINC) {	// wait for PINC to settle
-			pincstore = PINC;
-			cur_volpos = gray2num((((pincstore>>PINC_VOLDN)&1)<<1)|((pincstore>>PINC_VOLUP)&1));
-			debounce_time = ENC_DEBTIME;
-		}
-		_delay_us(100);
-		debounce_time--;
+	if(queued >= 2 && last->type == type &&
+	   (type == BUT_VOLINC || type == BUT_VOLDEC || 
+	    type == BUT_SELUPL || type == BUT_SELDNR)) {
+		steps += last->count;
+		last->count = (steps > BUT_MAXSTEPS) ? BUT_MAXSTEPS : steps;
+	} else if(queued < BUT_QLEN) {
+		but_queue[head & (BUT_QLEN - 1)].type = type;
+		but_queue[head & (BUT_QLEN - 1)].count = steps;
+		LAT_STAMP(but_queue[head & (BUT_QLEN - 1)].stamp);
+		but_qhead = head + 1;	// publish only after the slot is filled
 	}
+}
+
+/*
+ * Samples the buttons and both encoders.  Called from the tick interrupt.
+ * Each encoder's last and current 2-bit states index enc_table, so every
+ * sample costs the same regardless of which way (or whether) it moved.
+ */
+void but_tick() {
+	uint8_t pins = PINC;
 	
-	// check for volume knob movement
-	cur_volpos = gray2num((((pincstore>>PINC_VOLDN)&1)<<1)|((pincstore>>PINC_VOLUP)&1));
-	
-	if(old_volpos > 3) {		// set old_volpos if run for first time
-		old_volpos = cur_volpos;
-	} else if(old_volpos != cur_volpos) {	// handle movement
-		
-		// determine motion (there's got to be a simpler way)
-		switch(old_volpos) {
-		case 0:
-			if(cur_volpos == 1) {
-				volblips++;
-			} else if(cur_volpos == 3) {
-				volblips--;
-			}
-			break;
-		case 1:
-			if(cur_volpos == 2) {
-				volblips++;
-			} else if(cur_volpos == 0) {
-				volblips--;
-			}
-			break;
-		case 2:
-			if(cur_volpos == 3) {
-				volblips++;
-			} else if(cur_volpos == 1) {
-				volblips--;
-			}
-			break;
-		case 3:
-			if(cur_volpos == 0) {
-				volblips++;
-			} else if(cur_volpos == 2) {
-				volblips--;
-			}
-			break;
-		}
-		
-		if(volblips >= 4) {
-			but_outstanding = BUT_VOLINC;
-			volblips = 0;
-		} else if(volblips <= -4) {
-			but_outstanding = BUT_VOLDEC;
-			volblips = 0;
-		}
-		
-		if(cur_volpos == 0) volblips = 0;	// keep volblips aligned with detent
-		
-		old_volpos = cur_volpos;
+	if(--but_divider == 0) {
+		but_divider = BUT_SAMPLETICKS;
+		but_debounce(pins);
 	}
 	
-	// check for selector knob movement
-	cur_selpos = gray2num((((pincstore>>PINC_RIGHT)&1)<<1)|((pincstore>>PINC_LEFT)&1));
-	
-	if(old_selpos > 3) {		// set old_volpos if run for first time
-		old_selpos = cur_selpos;
-	} else if(old_selpos != cur_selpos) {	// handle movement
+	for(uint8_t i = 0; i < ENC_N; i++) {
+		uint8_t state = (pins >> pgm_read_byte(&enc_shift[i])) & 0x03;
+		int8_t blips = enc_blips[i] + (int8_t)pgm_read_byte(&enc_table[(enc_state[i] << 2) | state]);
 		
-		// determine motion (there's got to be a simpler way)
-		switch(old_selpos) {
-		case 0:
-			if(cur_selpos == 1) {
-				selblips++;
-			} else if(cur_selpos == 3) {
-				selblips--;
-			}
-			break;
-		case 1:
-			if(cur_selpos == 2) {
-				selblips++;
-			} else if(cur_selpos == 0) {
-				selblips--;
-			}
-			break;
-		case 2:
-			if(cur_selpos == 3) {
-				selblips++;
-			} else if(cur_selpos == 1) {
-				selblips--;
+		enc_state[i] = state;
+		if(enc_idle[i] < 0xff) enc_idle[i]++;
+		if(state == ENC_DETENT) {		// resting: decide on the detent just passed
+			if(blips >= ENC_MINBLIPS) {
+				but_pushn(pgm_read_byte(&enc_events[i][0]), enc_steps(i));
+			} else if(blips <= -ENC_MINBLIPS) {
+				but_pushn(pgm_read_byte(&enc_events[i][1]), enc_steps(i));
 			}
-			break;
-		case 3:
-			if(cur_selpos == 0) {
-				selblips++;
-			} else if(cur_selpos == 2) {
-				selblips--;
-			}
-			break;
-		}
-		
-		if(selblips >= 4) {
-			but_outstanding = BUT_SELUPL;
-			volblips = 0;
-		} else if(selblips <= -4) {
-			but_outstanding = BUT_SELDNR;
-			selblips = 0;
+			blips = 0;					// keep blips aligned with detent
 		}
-		
-		if(cur_selpos == 0) selblips = 0;	// keep selblips aligned with detent
-		
-		old_selpos = cur_selpos;
+		enc_blips[i] = blips;
 	}
 }
 
-// processes any pressed local buttons
-static void but_check() {
-	uint8_t pressedbyte = (~PINC) & PINC_BUTMASK;
+/*
+ * Gets the number of steps a detent of encoder i is worth, from the time
+ * since its previous detent and enc_accel.  Restarts the detent timer.
+ */
+static uint8_t enc_steps(uint8_t i) {
+	uint8_t steps = 1;
+	uint8_t idle = enc_idle[i];
 	
-	if(pressedbyte) {
-		for(uint8_t timeleft = BUT_DEBTIME; timeleft > 0; timeleft--) {
-			if((PINC & PINC_BUTMASK) != PINC_BUTMASK) timeleft = BUT_DEBTIME;
-			_delay_ms(1);
+	enc_idle[i] = 0;
+	if(pgm_read_byte(&enc_accelerated[i])) {
+		for(uint8_t a = 0; a < ENC_NACCEL; a++) {
+			if(idle < pgm_read_byte(&enc_accel[a].ms)) {
+				steps = pgm_read_byte(&enc_accel[a].steps);
+				break;
+			}
 		}
-		
-		but_outstanding = pressedbyte;
 	}
+	return steps;
 }
 
-/* Waits for a remote button press, then waits for button to be released.
- * Returns enum but_type of button pressed.  Returns BUT_NONE if no packets
- * received within REM_TIMEOUT.
- *
- * Clears TIMER1_CAPT_vect caused by button lifting.
+/*
+ * Debounces the local buttons.  Called every BUT_SAMPLETICKS ticks with a
+ * fresh PINC sample.
  *
- * If REM_TIMEOUT passes, sets outstanding to BUT_NONE
+ * Each button bit has a 2-bit counter, held "vertically" across but_cnt0
+ * and but_cnt1 so all buttons are counted in parallel.  A counter runs
+ * while its input differs from but_state and resets when it agrees; the
+ * fourth differing sample in a row flips the debounced state.
  */
-static void rem_check() {
-	uint16_t packet, pulsestart, pulseend, pulselength, listenstart;
-	uint8_t good, bit, data, address;
+static void but_debounce(uint8_t pins) {
+	uint8_t changed = but_state ^ (~pins & PINC_BUTMASK);	// pressed is low
 	
-	good = 0;
-	while(!good) {
-		do {
-			if(PINB & 1<<REM_RX) {			// pulse hasn't started
-				TCCR1B &= ~(1<<ICES1);		// set capture on falling edge (pulse start)
-				TIFR1 = 1<<ICF1;			// clear any capture flag
-				listenstart = TCNT1;		// save listen start time
-				while((!(TIFR1 & (1<<ICF1)))) {// wait for capture or listen timeout
-					if(TCNT1 - listenstart > REM_TIMEOUT) {
-						return;				// abort listen in case of timeout
-					}
-				}
-				pulsestart = ICR1;			// save start timestamp
-				TCCR1B |= 1<<ICES1;			// set capture on rising edge (pulse end)
-				TIFR1 = 1<<ICF1;			// clear capture flag
-				while((!(TIFR1 & (1<<ICF1))));// wait for capture
-				pulseend = ICR1;				// save end timestamp
-				TCCR1B &= ~(1<<ICES1);		// set capture back to falling edge
-				TIFR1 = 1<<ICF1;			// clear capture flag
-			} else {						// pulse in progress
-				pulsestart = ICR1;			// get the start time ASAP
-				TCCR1B |= 1<<ICES1;			// set capture on rising edge (pulse end)
-				TIFR1 = 1<<ICF1;			// clear capture flag
-				while((!(TIFR1 & (1<<ICF1))));// wait for capture
-				pulseend = ICR1;				// save end timestamp
-				TCCR1B &= ~(1<<ICES1);		// set capture back to falling edge
-				TIFR1 = 1<<ICF1;			// clear capture flag
-			}
-			
-			pulselength = pulseend - pulsestart;
-			
-		} while (pulselength < 2100 || pulselength > 2700);
-		
-		good = 1;
-		packet = bit = 0;
-		
-		// get 12-bit data packet
-		while (good && bit < 12) {
-			// look for pulse start
-			TCCR1B &= ~(1<<ICES1);		// set capture on falling edge (pulse start)
-			TIFR1 = 1<<ICF1;			// clear any capture flag
-			listenstart = TCNT1;		// save listen start time
-			while((!(TIFR1 & (1<<ICF1)))) {// wait for capture or timeout
-				if(TCNT1 - listenstart > 900) {	
-					return;				// abort listen in case of timeout
-				}
-			}
-			pulsestart = ICR1;			// save start timestamp
-			
-			// look for pulse end
-			TCCR1B |= 1<<ICES1;			// set capture on rising edge (pulse end)
-			TIFR1 = 1<<ICF1;			// clear capture flag
-			while((!(TIFR1 & (1<<ICF1))));// wait for capture or timeout
-			pulseend = ICR1;				// save end timestamp
-			TCCR1B &= ~(1<<ICES1);		// set capture back to falling edge
-			TIFR1 = 1<<ICF1;			// clear capture flag
-			
-			pulselength = pulseend - pulsestart;
-		
-			// interpret pulse
-			if(pulselength < 450) {		// too short
-				good = packet = 0;		// reset receive
-			} else if (pulselength < 750) { // data zero
-				bit++;
-			} else if (pulselength < 900) { // bad data
-				good = packet = 0;		// reset receive
-			} else if (pulselength < 1500) {// data one
-				packet |= 1<<bit;
-				bit++;
-			}
-		}
+	but_cnt0 = ~(but_cnt0 & changed);
+	but_cnt1 = but_cnt0 ^ (but_cnt1 & changed);
+	changed &= but_cnt0 & but_cnt1;		// counters that rolled over
+	but_state ^= changed;
+	
+	if(but_state & changed) {			// newly pressed
+		but_holdtime = 0;
+		but_push(but_state & changed);
+	}
+	if(~but_state & changed) {			// newly released
+		uint8_t held = but_holdtime / BUT_HOLDUNIT;
 		
-		// check for correct address
-		address = packet >> 7;			// address is in high 5 bits
-		if(address != REM_ADDRESS) {	// throw out wrong-address packets
-			good = 0;
-		}
+		but_pushn((~but_state & changed) | BUT_RELEASED, held ? held : 1);	// a tap counts as 0.1 s
 	}
-	
-	data = packet & 0x7f;	// get data from lower 7 bits
-	
-	// wait for button to be lifted
-	TCNT1 = 0;
-	do {
-		if((~PINB) & 1<<REM_RX) TCNT1 = 0;
-	} while(TCNT1 < REM_TIMEOUT);
-	TIFR1 = 1<<ICF1;			// clear capture flag
-	
-	
-	
-	// interpret data
-	switch(data) {
-	case 0x60:
-	case 0x65:
-		but_outstanding = BUT_ENTER;
-		break;
-	case 0x63:
-		but_outstanding = BUT_BACK;
-		break;
-	case 0x12:
-		but_outstanding = BUT_VOLINC;
-		break;
-	case 0x13:
-		but_outstanding = BUT_VOLDEC;
-		break;
-	case 0x10:
-		but_outstanding = BUT_SELDNR;
-		break;
-	case 0x11:
-		but_outstanding = BUT_SELUPL;
-		break;
-	case 0x74:
-		but_outstanding = BUT_DIRUP;
-		break;
-	case 0x75:
-		but_outstanding = BUT_DIRDN;
-		break;
-	case 0x34:
-		but_outstanding = BUT_DIRLEFT;
-		break;
-	case 0x33:
-		but_outstanding = BUT_DIRRIGHT;
-		break;
-	default:
-		//but_outstanding = BUT_NONE;
-		break;
+	if(but_state) {						// time the hold
+		if(but_holdtime < BUT_MAXHOLD) but_holdtime++;
+		if(but_holdtime == BUT_HOLDTIME) but_push(but_state | BUT_HELD);
 	}
 }
-
-// called when a rotary encoder or button state changes
-ISR(PCINT1_vect) {
-	but_check();
-	enc_check();
-	PCIFR = 1<<PCIF1;	// clear PCINT1 caused by switch motion
-}
-
-// called when an IR pulse is received
-ISR(TIMER1_CAPT_vect) {
-	rem_check();
-}
-
-static uint8_t gray2num(uint8_t g) {
-	switch(g) {
-	case 3:
-		return 0;
-		break;
-	case 2:
-		return 1;	// 0g10 == 0b11
-		break;
-	case 0:
-		return 2;
-		break;
-	case 1:
-	default:
-		return 3;
-		break;
-	}
-}
\ No newline at end of file
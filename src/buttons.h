@@ -22,6 +22,7 @@
 
 #include <stdint.h>
 #include "pins.h"
+#include "latency.h"
 
 // Note: these numeric definitions are essential to simplify things in buttons.c
 enum but_type {
@@ -35,15 +36,55 @@ enum but_type {
 	BUT_DIRRIGHT,					 // Directional right button (remote only)
 	BUT_DIRUP,						 // Directional up button (remote only)
 	BUT_DIRDN,						 // Directional down button (remote only)
+	BUT_MUTE,						 // Mute toggle (remote only)
+	BUT_BASSINC,					 // Bass increment (remote only)
+	BUT_BASSDEC,					 // Bass decrement (remote only)
+	BUT_TREBINC,					 // Treble increment (remote only)
+	BUT_TREBDEC,					 // Treble decrement (remote only)
+	BUT_HELD    = 0x40,				 // Flag: local buttons held for a second
+	BUT_RELEASED = 0x80,			 // Flag: local buttons released
     BUT_NONE    = 0                  // No or invalid button press
 };
 
-// sets up inputs (TBI: Timer)
+#define BUT_QLEN 8			// event queue length, must be a power of two
+#define BUT_MAXSTEPS 127	// most steps merged into one event (fits an int8_t)
+
+/* a queued input event
+   Local buttons also queue BUT_HELD and BUT_RELEASED events, OR'd with the
+   buttons concerned.  For BUT_RELEASED, count is the time the buttons were
+   held, in tenths of a second (at least 1).  Every queued event has a
+   count of at least 1. */
+struct but_event {
+	enum but_type type;
+	uint8_t count;		// number of identical presses/steps merged into this event
+#ifdef LATENCY
+	struct lat_stamp stamp;	// when the first of them was detected
+#endif
+};
+
+// sets up inputs
 void butinit();
 
-// Accepts any outstanding button press
+// samples the buttons and encoders; called from the tick interrupt only
+void but_tick();
+
+/* Adds an event to the queue.  Repeated volume/selector events are merged
+   into one event with a step count.  Events are dropped when the queue is
+   full.  Interrupt context only. */
+void but_push(enum but_type type);
+
+// same as but_push(), but the event is worth several steps
+void but_pushn(enum but_type type, uint8_t steps);
+
+/* Accepts one step of the oldest outstanding button press.  If several
+   steps were merged into that event, the rest stay queued. */
 enum but_type but_pop();
 
+/* Accepts the oldest outstanding event with all its merged steps.
+   The number of steps is stored in *steps.  Returns BUT_NONE if nothing
+   was queued; check that, not *steps, which is then left 0. */
+enum but_type but_popn(uint8_t * steps);
+
 // Checks for any outstanding button presses
 enum but_type but_peek();
 
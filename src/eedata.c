@@ -0,0 +1,32 @@
+/*
+ * eedata.c - EEPROM settings added since version 0.3.0
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Must stay last in the Makefile's SRC (see eedata.h).  Erased EEPROM
+ * reads as 0xff, which the users of each field take as "not set yet".
+ */ 
+
+#include <avr/eeprom.h>
+#include "spi.h"
+#include "preamp.h"
+#include "eedata.h"
+
+struct ee_data EEMEM ee_data = {
+	SPI_SPEEDUNKNOWN,
+	SPI_SPEEDUNKNOWN,
+	PRE_RAMPDEFAULT
+};
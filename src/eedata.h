@@ -0,0 +1,44 @@
+/*
+ * eedata.h - EEPROM settings added since version 0.3.0
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Settings that version 0.3.0 already had are EEMEM variables of their own
+ * modules.  Those added since live in ee_data instead (apart from
+ * remote.c's key table, which links after them too), and eedata.c is
+ * linked last so the block lands after all of them.  That only matters
+ * when just the flash is rewritten (avrdude -U flash:w:..., with the
+ * EESAVE fuse set so the chip erase spares the EEPROM): the 0.3.0
+ * settings are then still where the new firmware looks for them.  "make
+ * program" writes the .eep image too, which resets every setting anyway.
+ * New settings go at the end of struct ee_data.
+ */ 
+
+#ifndef EEDATA_H_
+#define EEDATA_H_
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+
+struct ee_data {
+	uint8_t vfdspispeed;	// display SPI speed, chosen by vfd_calibrate()
+	uint8_t potspispeed;	// pot SPI speed, chosen by pre_calibrate()
+	uint8_t ramp;			// pot codes per volume and tone ramp step
+};
+
+extern struct ee_data ee_data;
+
+#endif /* EEDATA_H_ */
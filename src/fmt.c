@@ -0,0 +1,86 @@
+/*
+ * fmt.c - Display formatting for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Numbers are converted by subtracting powers of ten rather than
+ * dividing, which the ATmega168 has to do in software.  A five-digit
+ * number costs at most 45 subtractions.
+ */ 
+
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include "vfd.h"
+#include "fmt.h"
+
+#define FMT_NDIGITS 5		// digits in the largest uint16_t
+
+static const uint16_t PROGMEM fmt_powers[FMT_NDIGITS] = {
+	10000, 1000, 100, 10, 1
+};
+
+static uint8_t fmt_digits(uint8_t pos, uint16_t n, char sign, uint8_t flags);
+
+uint8_t fmt_label_P(uint8_t pos, PGM_P label_P) {
+	char c;
+	
+	while((c = pgm_read_byte(label_P++)) != 0) {
+		vfd_setcell(pos++, c);
+	}
+	return pos;
+}
+
+uint8_t fmt_uint(uint8_t pos, uint16_t n, uint8_t flags) {
+	return fmt_digits(pos, n, (flags & FMT_SIGN) ? '+' : 0, flags);
+}
+
+uint8_t fmt_int(uint8_t pos, int16_t n, uint8_t flags) {
+	if(n < 0) return fmt_digits(pos, -(uint16_t)n, '-', flags);
+	return fmt_uint(pos, n, flags);
+}
+
+void fmt_clear(uint8_t pos) {
+	while(pos < VFD_NCELLS) {
+		vfd_setcell(pos++, ' ');
+	}
+}
+
+/*
+ * Writes the magnitude n with an optional sign character in front.
+ * Leading zeros are dropped down to the units digit, or down to the one
+ * before the decimal point in fixed point.
+ */
+static uint8_t fmt_digits(uint8_t pos, uint16_t n, char sign, uint8_t flags) {
+	uint8_t decimals = flags & FMT_DECIMALS;
+	uint8_t point = FMT_NDIGITS - decimals;	// digit the decimal point goes before
+	uint8_t i;
+	uint16_t p;
+	char d;
+	
+	for(i = 0; i < point - 1 && n < pgm_read_word(&fmt_powers[i]); i++);	// skip leading zeros
+	if((flags & FMT_WIDTH2) && !sign && i == FMT_NDIGITS - 1) {
+		vfd_setcell(pos++, ' ');		// right-align a single digit
+	}
+	if(sign) vfd_setcell(pos++, sign);
+	
+	for(; i < FMT_NDIGITS; i++) {
+		if(i == point) vfd_setcell(pos++, '.');
+		p = pgm_read_word(&fmt_powers[i]);
+		for(d = '0'; n >= p; d++) n -= p;
+		vfd_setcell(pos++, d);
+	}
+	return pos;
+}
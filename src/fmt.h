@@ -0,0 +1,48 @@
+/*
+ * fmt.h - Display formatting for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Writes labels and numbers straight into the display framebuffer, so
+ * the display path does not need snprintf_P and the vfprintf behind it.
+ * Each function takes the cell to start at and returns the cell after
+ * the last one written; cells past the end of the display are dropped.
+ */ 
+
+#ifndef FMT_H_
+#define FMT_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+// flags for fmt_uint() and fmt_int()
+#define FMT_DECIMALS 0x03	// mask: digits after the decimal point (fixed point)
+#define FMT_SIGN 0x04		// always show the sign, like %+d
+#define FMT_WIDTH2 0x08		// pad with spaces to at least two characters
+
+// writes a label from program space
+uint8_t fmt_label_P(uint8_t pos, PGM_P label_P);
+
+// writes an unsigned number
+uint8_t fmt_uint(uint8_t pos, uint16_t n, uint8_t flags);
+
+// writes a signed number
+uint8_t fmt_int(uint8_t pos, int16_t n, uint8_t flags);
+
+// blanks the framebuffer from cell pos to the end of the display
+void fmt_clear(uint8_t pos);
+
+#endif /* FMT_H_ */
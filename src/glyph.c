@@ -0,0 +1,169 @@
+/*
+ * glyph.c - User-defined character manager for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Reusing a slot changes every cell already showing it, so a slot that
+ * vfd_userchars() reports is never reused: the display may still show it
+ * until the next frame goes out, a held frame may be about to, or the
+ * marquee may scroll it back in.  Of the rest the least recently used is
+ * taken, so a frame being drawn keeps the glyphs it has already got.
+ */ 
+
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include "vfd.h"
+#include "glyph.h"
+
+#define GLYPH_NOSLOT 0xff	// glyph_where value for glyphs not loaded
+#define GLYPH_NLATIN1 13	// entries in glyph_latin1map
+
+/*
+ * Glyph library.  Each byte is a column, bit 0 at the top.
+ */
+static const uint8_t PROGMEM glyph_library[GLYPH_N][VFD_GLYPHCOLS] = {
+	{0x7f, 0x00, 0x00, 0x00, 0x00},	// GLYPH_BAR1
+	{0x7f, 0x7f, 0x00, 0x00, 0x00},	// GLYPH_BAR2
+	{0x7f, 0x7f, 0x7f, 0x00, 0x00},	// GLYPH_BAR3
+	{0x7f, 0x7f, 0x7f, 0x7f, 0x00},	// GLYPH_BAR4
+	{0x04, 0x02, 0x7f, 0x02, 0x04},	// GLYPH_UP
+	{0x10, 0x20, 0x7f, 0x20, 0x10},	// GLYPH_DOWN
+	{0x08, 0x1c, 0x2a, 0x08, 0x08},	// GLYPH_LEFT
+	{0x08, 0x08, 0x2a, 0x1c, 0x08},	// GLYPH_RIGHT
+	{0x1c, 0x3e, 0x14, 0x08, 0x14},	// GLYPH_MUTE
+	{0x3e, 0x31, 0x01, 0x31, 0x3e},	// GLYPH_HEADPHONE
+	{0x20, 0x55, 0x54, 0x55, 0x78},	// GLYPH_AUML
+	{0x38, 0x54, 0x56, 0x55, 0x18},	// GLYPH_EACUTE
+	{0x38, 0x55, 0x56, 0x54, 0x18},	// GLYPH_EGRAVE
+	{0x38, 0x45, 0x44, 0x45, 0x38},	// GLYPH_OUML
+	{0x3c, 0x41, 0x40, 0x61, 0x7c},	// GLYPH_UUML
+	{0x20, 0x55, 0x56, 0x54, 0x78},	// GLYPH_AGRAVE
+	{0x38, 0x56, 0x55, 0x56, 0x18},	// GLYPH_ECIRC
+	{0x0c, 0x12, 0x52, 0x32, 0x04},	// GLYPH_CCEDIL
+	{0x7a, 0x09, 0x05, 0x06, 0x79},	// GLYPH_NTILDE
+	{0x79, 0x14, 0x12, 0x14, 0x79},	// GLYPH_AUMLCAP
+	{0x39, 0x44, 0x44, 0x44, 0x39},	// GLYPH_OUMLCAP
+	{0x3d, 0x40, 0x40, 0x40, 0x3d},	// GLYPH_UUMLCAP
+	{0x7e, 0x01, 0x49, 0x4e, 0x30}	// GLYPH_SZLIG
+};
+
+// Latin-1 characters shown with library glyphs
+static const struct {
+	uint8_t latin1;
+	uint8_t glyph;
+} PROGMEM glyph_latin1map[GLYPH_NLATIN1] = {
+	{0xc4, GLYPH_AUMLCAP},
+	{0xd6, GLYPH_OUMLCAP},
+	{0xdc, GLYPH_UUMLCAP},
+	{0xdf, GLYPH_SZLIG},
+	{0xe0, GLYPH_AGRAVE},
+	{0xe4, GLYPH_AUML},
+	{0xe7, GLYPH_CCEDIL},
+	{0xe8, GLYPH_EGRAVE},
+	{0xe9, GLYPH_EACUTE},
+	{0xea, GLYPH_ECIRC},
+	{0xf1, GLYPH_NTILDE},
+	{0xf6, GLYPH_OUML},
+	{0xfc, GLYPH_UUML}
+};
+
+static uint8_t glyph_slot[VFD_NUSERCHARS];	// glyph in each slot (GLYPH_N: empty)
+static uint8_t glyph_where[GLYPH_N];		// slot holding each glyph (GLYPH_NOSLOT: none)
+static uint16_t glyph_used[VFD_NUSERCHARS];	// glyph_clock when each slot was last used
+static uint16_t glyph_clock = 0;			// counts glyph_get() calls
+
+// statistics
+static uint16_t glyph_hits = 0;
+static uint16_t glyph_misses = 0;
+
+static void glyph_load(uint8_t slot, enum glyph_id g);
+
+void glyphinit() {
+	uint8_t i;
+	
+	for(i = 0; i < VFD_NUSERCHARS; i++) {
+		glyph_slot[i] = GLYPH_N;
+	}
+	for(i = 0; i < GLYPH_N; i++) {
+		glyph_where[i] = GLYPH_NOSLOT;
+	}
+}
+
+char glyph_get(enum glyph_id g) {
+	uint8_t slot = glyph_where[g];
+	
+	glyph_clock++;
+	
+	if(slot != GLYPH_NOSLOT) {
+		if(glyph_hits < 0xffff) glyph_hits++;
+	} else {
+		// take an empty slot, or else the least recently used one the display doesn't need
+		uint16_t pinned = vfd_userchars();
+		uint16_t oldest = 0;
+		slot = GLYPH_NOSLOT;
+		for(uint8_t i = 0; i < VFD_NUSERCHARS; i++) {
+			uint16_t age = glyph_clock - glyph_used[i];	// wrap-safe
+			if(glyph_slot[i] == GLYPH_N) {
+				slot = i;
+				break;
+			}
+			if(pinned & (1 << i)) continue;
+			if(age > oldest) {
+				oldest = age;
+				slot = i;
+			}
+		}
+		if(glyph_misses < 0xffff) glyph_misses++;
+		if(slot == GLYPH_NOSLOT) return 0;		// every slot is still on show
+		if(glyph_slot[slot] != GLYPH_N) glyph_where[glyph_slot[slot]] = GLYPH_NOSLOT;	// evict
+		glyph_slot[slot] = g;
+		glyph_where[g] = slot;
+		glyph_load(slot, g);
+	}
+	
+	glyph_used[slot] = glyph_clock;
+	return VFD_USERCHAR + slot;
+}
+
+char glyph_latin1(char c) {
+	for(uint8_t i = 0; i < GLYPH_NLATIN1; i++) {
+		if(pgm_read_byte(&glyph_latin1map[i].latin1) == (uint8_t)c) {
+			return glyph_get(pgm_read_byte(&glyph_latin1map[i].glyph));
+		}
+	}
+	return 0;
+}
+
+uint16_t glyph_gethits() {
+	return glyph_hits;
+}
+
+uint16_t glyph_getmisses() {
+	return glyph_misses;
+}
+
+/*
+ * Loads a glyph from the library into a user character slot
+ */
+static void glyph_load(uint8_t slot, enum glyph_id g) {
+	vfd_begin();
+	vfd_write(VFD_SETUSERCHAR);
+	vfd_write(VFD_USERCHAR + slot);
+	for(uint8_t col = 0; col < VFD_GLYPHCOLS; col++) {
+		vfd_write(pgm_read_byte(&glyph_library[g][col]));
+	}
+	vfd_end();
+}
@@ -0,0 +1,77 @@
+/*
+ * glyph.h - User-defined character manager for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * The display has only VFD_NUSERCHARS user-definable characters, and
+ * loading one costs 7 bytes on the bus.  Glyphs from the library are
+ * loaded into those slots on demand and the least recently used slot the
+ * display no longer needs is reused when they are all taken.
+ */ 
+
+#ifndef GLYPH_H_
+#define GLYPH_H_
+
+#include <stdint.h>
+
+enum glyph_id {
+	GLYPH_BAR1,			// bar graph cell, 1 to 4 columns lit
+	GLYPH_BAR2,
+	GLYPH_BAR3,
+	GLYPH_BAR4,
+	GLYPH_UP,			// arrows
+	GLYPH_DOWN,
+	GLYPH_LEFT,
+	GLYPH_RIGHT,
+	GLYPH_MUTE,			// speaker with a cross
+	GLYPH_HEADPHONE,
+	GLYPH_AUML,			// accented letters
+	GLYPH_EACUTE,
+	GLYPH_EGRAVE,
+	GLYPH_OUML,
+	GLYPH_UUML,
+	GLYPH_AGRAVE,
+	GLYPH_ECIRC,
+	GLYPH_CCEDIL,
+	GLYPH_NTILDE,
+	GLYPH_AUMLCAP,
+	GLYPH_OUMLCAP,
+	GLYPH_UUMLCAP,
+	GLYPH_SZLIG,
+	GLYPH_N				// more than the display's slots, which are shared out by LRU
+};
+
+// empties all slots
+void glyphinit();
+
+/* gets the character code that shows glyph g, loading it into a slot
+   first if it is not already there.  Call while drawing a frame; a frame
+   can use up to VFD_NUSERCHARS different glyphs.  Slots the display still
+   needs (see vfd_userchars()) are not reused; if that leaves none, returns
+   0 and the caller shows something else. */
+char glyph_get(enum glyph_id g);
+
+/* gets the character code for a Latin-1 character with a glyph in the
+   library, or 0 if there is none */
+char glyph_latin1(char c);
+
+// gets the number of glyph_get() calls that found the glyph already loaded
+uint16_t glyph_gethits();
+
+// gets the number of glyph_get() calls that had to load the glyph
+uint16_t glyph_getmisses();
+
+#endif /* GLYPH_H_ */
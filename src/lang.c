@@ -23,14 +23,14 @@
 
 const char PROGMEM LANG_SPLASH[] 		= "AIA Rev. B";
 
-const char PROGMEM LANG_VOLUME[] 		= "Volume: %hhu";	// it's a format string
-
 const char PROGMEM LANG_TC[] 			= "Tone>";
 const char PROGMEM LANG_TC_SPKONLY[] 	= 	"Active: Spk only";
 const char PROGMEM LANG_TC_ALWAYS[] 	=   "Active: Always";
 const char PROGMEM LANG_TC_NEVER[] 		=   "Active: Never";
-const char PROGMEM LANG_TC_BASS[] 		=   "Bass: %+hhd";
-const char PROGMEM LANG_TC_TREBLE[] 	=   "Treb: %+hhd";
+const char PROGMEM LANG_TC_BASS[] 		=   "Bass: ";	// NOT format strings
+const char PROGMEM LANG_TC_TREBLE[] 	=   "Treb: ";
+const char PROGMEM LANG_TL_BASS[]		= "Bass";	// tone layer, NOT format strings
+const char PROGMEM LANG_TL_TREBLE[]		= "Treb";
 
 const char PROGMEM LANG_SPK_AUTO[] 		= "Speakers: Auto";
 const char PROGMEM LANG_SPK_ON[] 		= "Speakers: Always";
@@ -47,7 +47,137 @@ const char PROGMEM LANG_IN6[] 			=   "L6: ";
 const char PROGMEM LANG_IN7[]  			=   "L7: ";
 
 const char PROGMEM LANG_BRIGHTNESS[] 	= "Brightness>";
-const char PROGMEM LANG_ACTIVEBRIGHTNESS[] = "Active Bright: %hhu";
-const char PROGMEM LANG_IDLEBRIGHTNESS[] =	"Idle Bright: %hhd";
+const char PROGMEM LANG_ACTIVEBRIGHTNESS[] = "Active Bright: ";
+const char PROGMEM LANG_IDLEBRIGHTNESS[] =	"Idle Bright: ";
+
+const char PROGMEM LANG_KEYS[]			= "Remote Keys>";
+const char PROGMEM LANG_KEYS_LEARN[]	=   "Learn: ";
+const char PROGMEM LANG_KEYS_RESET[]	=   "Reset Keys";
+const char PROGMEM LANG_KEYS_WAIT[]		=   "Press remote key";
+const char PROGMEM LANG_KEYS_DONE[]		=   "Key learned";
+const char PROGMEM LANG_KEYS_FULL[]		=   "E: Keys full";
+
+const char PROGMEM LANG_SPICAL[]		= "Tune SPI Clocks";
+const char PROGMEM LANG_SPICAL_VFD[]	=   "VFD /";	// NOT format strings
+const char PROGMEM LANG_SPICAL_POTS[]	=   "Pots /";
+const char PROGMEM LANG_SPICAL_NOPOTS[]	=   "Pots untested";
+const char PROGMEM LANG_SPICAL_US[]		=   "us";
+
+const char PROGMEM LANG_RAMP[]			= "Ramp Step: ";	// NOT a format string
+
+static const char PROGMEM LANG_ACT_ENTER[]	= "Enter";
+static const char PROGMEM LANG_ACT_BACK[]	= "Back";
+static const char PROGMEM LANG_ACT_VOLINC[]	= "Vol Up";
+static const char PROGMEM LANG_ACT_VOLDEC[]	= "Vol Down";
+static const char PROGMEM LANG_ACT_PREVIN[]	= "Prev In";
+static const char PROGMEM LANG_ACT_NEXTIN[]	= "Next In";
+static const char PROGMEM LANG_ACT_UP[]		= "Up";
+static const char PROGMEM LANG_ACT_DOWN[]	= "Down";
+static const char PROGMEM LANG_ACT_LEFT[]	= "Left";
+static const char PROGMEM LANG_ACT_RIGHT[]	= "Right";
+static const char PROGMEM LANG_ACT_MUTE[]	= "Mute";
+static const char PROGMEM LANG_ACT_BASSINC[]	= "Bass Up";
+static const char PROGMEM LANG_ACT_BASSDEC[]	= "Bass Down";
+static const char PROGMEM LANG_ACT_TREBINC[]	= "Treb Up";
+static const char PROGMEM LANG_ACT_TREBDEC[]	= "Treb Down";
+static const char PROGMEM LANG_ACT_NONE[]	= "Nothing";
+
+PGM_P const PROGMEM LANG_KEYS_ACTIONS[] = {
+	LANG_ACT_ENTER,
+	LANG_ACT_BACK,
+	LANG_ACT_VOLINC,
+	LANG_ACT_VOLDEC,
+	LANG_ACT_PREVIN,
+	LANG_ACT_NEXTIN,
+	LANG_ACT_UP,
+	LANG_ACT_DOWN,
+	LANG_ACT_LEFT,
+	LANG_ACT_RIGHT,
+	LANG_ACT_MUTE,
+	LANG_ACT_BASSINC,
+	LANG_ACT_BASSDEC,
+	LANG_ACT_TREBINC,
+	LANG_ACT_TREBDEC,
+	LANG_ACT_NONE
+};
+
+#if defined(BENCH) || defined(LATENCY)
+const char PROGMEM LANG_DIAG[]			= "Diagnostics>";
+#endif
+
+#ifdef BENCH
+const char PROGMEM LANG_DIAG_CYCLES[]	= "%S: %u";	// label, cycles
+
+static const char PROGMEM LANG_BENCH_REMISR[]	= "IR isr";
+static const char PROGMEM LANG_BENCH_TICKISR[]	= "Tick isr";
+static const char PROGMEM LANG_BENCH_TICKWORK[]	= "Tick+isrs";	// includes interrupts nested in it
+static const char PROGMEM LANG_BENCH_SIRC[]		= "SIRC edge";
+static const char PROGMEM LANG_BENCH_NEC[]		= "NEC edge";
+static const char PROGMEM LANG_BENCH_RC5[]		= "RC5 edge";
+static const char PROGMEM LANG_BENCH_VFDCOMMIT[]	= "VFD commit";
+static const char PROGMEM LANG_BENCH_VFDCLEAR[]	= "VFD clear";
+static const char PROGMEM LANG_BENCH_VFDPERBYTE[]	= "VFD per-byte";
+static const char PROGMEM LANG_BENCH_FMT[]		= "Fmt";
+static const char PROGMEM LANG_BENCH_PRINTF[]	= "Printf";
+static const char PROGMEM LANG_BENCH_POTXFER[]	= "Pot xfer";
+
+PGM_P const PROGMEM LANG_BENCH_SLOTS[] = {
+	LANG_BENCH_REMISR,
+	LANG_BENCH_TICKISR,
+	LANG_BENCH_TICKWORK,
+	LANG_BENCH_SIRC,
+	LANG_BENCH_NEC,
+	LANG_BENCH_RC5,
+	LANG_BENCH_VFDCOMMIT,
+	LANG_BENCH_VFDCLEAR,
+	LANG_BENCH_VFDPERBYTE,
+	LANG_BENCH_FMT,
+	LANG_BENCH_PRINTF,
+	LANG_BENCH_POTXFER
+};
+
+const char PROGMEM LANG_BENCH_SIGNED[]	= "%S%+hhd";	// label, value
+const char PROGMEM LANG_BENCH_UNSIGNED[]	= "%S%hhu";
+
+const char PROGMEM LANG_DIAG_FRAMES[]	= "%S good: %u";	// protocol, frames
+const char PROGMEM LANG_DIAG_ERRORS[]	= "%S bad: %u";
+
+static const char PROGMEM LANG_REM_SIRC[]	= "SIRC";
+static const char PROGMEM LANG_REM_NEC[]	= "NEC";
+static const char PROGMEM LANG_REM_RC5[]	= "RC5";
+
+PGM_P const PROGMEM LANG_REM_PROTOCOLS[] = {
+	LANG_REM_SIRC,
+	LANG_REM_NEC,
+	LANG_REM_RC5
+};
+
+const char PROGMEM LANG_DIAG_VFDSAVED[]	= "VFD saved: %lu";	// bytes
+const char PROGMEM LANG_DIAG_VFDSKIPPED[]	= "VFD skip: %lu";	// frames
+const char PROGMEM LANG_DIAG_GLYPHHITS[]	= "Glyph hits: %u";
+const char PROGMEM LANG_DIAG_GLYPHMISSES[]	= "Glyph miss: %u";
+const char PROGMEM LANG_DIAG_SPIFILL[]	= "SPI queue %u/%u";	// now, most
+const char PROGMEM LANG_DIAG_SPIXFERS[]	= "SPI xfers: %lu";
+const char PROGMEM LANG_DIAG_SPIBYTES[]	= "SPI bytes: %lu";
+#endif
+
+#ifdef LATENCY
+const char PROGMEM LANG_LAT_MIN[]		= "%S min %uus";	// stage, microseconds
+const char PROGMEM LANG_LAT_MEAN[]		= "%S avg %uus";
+const char PROGMEM LANG_LAT_MAX[]		= "%S max %uus";
+const char PROGMEM LANG_LAT_COUNT[]		= "%S n %u";		// stage, events
+const char PROGMEM LANG_LAT_BELOW[]		= "%S<%u %u";		// stage, bin bound, events
+const char PROGMEM LANG_LAT_ABOVE[]		= "%S>%u %u";
+
+static const char PROGMEM LANG_LAT_DISPATCH[]	= "Disp";
+static const char PROGMEM LANG_LAT_POTS[]		= "Pot";
+static const char PROGMEM LANG_LAT_VFD[]		= "VFD";
+
+PGM_P const PROGMEM LANG_LAT_STAGES[] = {
+	LANG_LAT_DISPATCH,
+	LANG_LAT_POTS,
+	LANG_LAT_VFD
+};
+#endif
 
 const char PROGMEM ERROR_CANTHAPPEN[]	= "E: Can't happen";
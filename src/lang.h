@@ -26,14 +26,14 @@
 
 extern const char LANG_SPLASH[] PROGMEM;
 
-extern const char LANG_VOLUME[] PROGMEM;
-
 extern const char LANG_TC[] PROGMEM;
 extern const char LANG_TC_SPKONLY[] PROGMEM;
 extern const char LANG_TC_ALWAYS[] PROGMEM;
 extern const char LANG_TC_NEVER[] PROGMEM;
 extern const char LANG_TC_BASS[] PROGMEM;
 extern const char LANG_TC_TREBLE[] PROGMEM;
+extern const char LANG_TL_BASS[] PROGMEM;
+extern const char LANG_TL_TREBLE[] PROGMEM;
 
 extern const char LANG_SPK_AUTO[] PROGMEM;
 extern const char LANG_SPK_ON[] PROGMEM;
@@ -53,6 +53,51 @@ extern const char LANG_BRIGHTNESS[] PROGMEM;
 extern const char LANG_ACTIVEBRIGHTNESS[] PROGMEM;
 extern const char LANG_IDLEBRIGHTNESS[] PROGMEM;
 
+extern const char LANG_KEYS[] PROGMEM;
+extern const char LANG_KEYS_LEARN[] PROGMEM;
+extern const char LANG_KEYS_RESET[] PROGMEM;
+extern const char LANG_KEYS_WAIT[] PROGMEM;
+extern const char LANG_KEYS_DONE[] PROGMEM;
+extern const char LANG_KEYS_FULL[] PROGMEM;
+extern PGM_P const LANG_KEYS_ACTIONS[] PROGMEM;	// one label per learnable action
+
+extern const char LANG_SPICAL[] PROGMEM;
+extern const char LANG_SPICAL_VFD[] PROGMEM;
+extern const char LANG_SPICAL_POTS[] PROGMEM;
+extern const char LANG_SPICAL_NOPOTS[] PROGMEM;
+extern const char LANG_SPICAL_US[] PROGMEM;
+
+extern const char LANG_RAMP[] PROGMEM;
+
+#if defined(BENCH) || defined(LATENCY)
+extern const char LANG_DIAG[] PROGMEM;
+#endif
+#ifdef BENCH
+extern const char LANG_DIAG_CYCLES[] PROGMEM;
+extern PGM_P const LANG_BENCH_SLOTS[] PROGMEM;	// one label per enum bench_slot
+extern const char LANG_BENCH_SIGNED[] PROGMEM;
+extern const char LANG_BENCH_UNSIGNED[] PROGMEM;
+extern const char LANG_DIAG_FRAMES[] PROGMEM;
+extern const char LANG_DIAG_ERRORS[] PROGMEM;
+extern PGM_P const LANG_REM_PROTOCOLS[] PROGMEM;	// one label per enum rem_protocol
+extern const char LANG_DIAG_VFDSAVED[] PROGMEM;
+extern const char LANG_DIAG_VFDSKIPPED[] PROGMEM;
+extern const char LANG_DIAG_GLYPHHITS[] PROGMEM;
+extern const char LANG_DIAG_GLYPHMISSES[] PROGMEM;
+extern const char LANG_DIAG_SPIFILL[] PROGMEM;
+extern const char LANG_DIAG_SPIXFERS[] PROGMEM;
+extern const char LANG_DIAG_SPIBYTES[] PROGMEM;
+#endif
+#ifdef LATENCY
+extern const char LANG_LAT_MIN[] PROGMEM;
+extern const char LANG_LAT_MEAN[] PROGMEM;
+extern const char LANG_LAT_MAX[] PROGMEM;
+extern const char LANG_LAT_COUNT[] PROGMEM;
+extern const char LANG_LAT_BELOW[] PROGMEM;
+extern const char LANG_LAT_ABOVE[] PROGMEM;
+extern PGM_P const LANG_LAT_STAGES[] PROGMEM;	// one label per enum lat_stage
+#endif
+
 extern const char ERROR_CANTHAPPEN[] PROGMEM;
 
 #endif /* LANG_H_ */
@@ -0,0 +1,144 @@
+/*
+ * latency.c - Optional input-to-output latency statistics for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Timer1 only spans 65.5 ms, so each stamp also carries the tick count.
+ * Anything the tick says took longer than LAT_MAXTICKS is saturated
+ * instead of trusting the wrapped timer.
+ *
+ * The stages after dispatch are recorded from the SPI and USART
+ * interrupts as transfers finish, so the UI side works with interrupts
+ * disabled.
+ */ 
+
+#include <avr/io.h>
+#include <stdint.h>
+#include <util/atomic.h>
+#include "tick.h"
+#include "latency.h"
+
+#ifdef LATENCY
+
+#define LAT_MAXTICKS 60		// longest time, in ticks, read from Timer1
+
+// running totals for one stage
+static struct {
+	uint16_t min;
+	uint16_t max;
+	uint32_t sum;
+	uint16_t count;
+	uint16_t hist[LAT_NBINS];
+} lat_acc[LAT_NSTAGES];
+
+static struct lat_stamp lat_event;	// detection time of the current event
+static uint8_t lat_pending = 0;		// stages of the current event with no transfer queued yet
+static uint8_t lat_started = 0;		// stages of the current event whose transfer is under way
+
+static uint16_t lat_since();
+static void lat_record(enum lat_stage stage, uint16_t t);
+
+void lat_now(volatile struct lat_stamp * stamp) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// keep the two clocks together
+		stamp->tick = tick_now();
+		stamp->us = TCNT1;
+	}
+}
+
+void lat_dispatch(const volatile struct lat_stamp * stamp) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// transfers of the last event may finish meanwhile
+		lat_event = *stamp;
+		lat_record(LAT_DISPATCH, lat_since());
+		lat_pending = (1<<LAT_POTS)|(1<<LAT_VFD);
+		lat_started = 0;
+	}
+}
+
+void lat_start(enum lat_stage stage) {
+	if(!(lat_pending & (1<<stage))) return;
+	lat_pending &= ~(1<<stage);
+	lat_started |= 1<<stage;
+}
+
+void lat_mark(enum lat_stage stage) {
+	if(!(lat_started & (1<<stage))) return;
+	lat_started &= ~(1<<stage);
+	lat_record(stage, lat_since());
+}
+
+void lat_getstats(enum lat_stage stage, struct lat_stats * stats) {
+	uint32_t sum;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		stats->count = lat_acc[stage].count;
+		stats->min = lat_acc[stage].min;
+		stats->max = lat_acc[stage].max;
+		sum = lat_acc[stage].sum;
+		for(uint8_t i = 0; i < LAT_NBINS; i++) {
+			stats->hist[i] = lat_acc[stage].hist[i];
+		}
+	}
+	stats->mean = stats->count ? sum / stats->count : 0;
+}
+
+void lat_reset() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for(uint8_t s = 0; s < LAT_NSTAGES; s++) {
+			lat_acc[s].min = lat_acc[s].max = 0;
+			lat_acc[s].sum = 0;
+			lat_acc[s].count = 0;
+			for(uint8_t i = 0; i < LAT_NBINS; i++) {
+				lat_acc[s].hist[i] = 0;
+			}
+		}
+		lat_pending = 0;
+		lat_started = 0;
+	}
+}
+
+/*
+ * Gets the microseconds since the current event was detected
+ */
+static uint16_t lat_since() {
+	struct lat_stamp now;
+	
+	lat_now(&now);
+	if((uint16_t)(now.tick - lat_event.tick) > LAT_MAXTICKS) return 0xffff;
+	return now.us - lat_event.us;
+}
+
+/*
+ * Adds a time to a stage's statistics
+ */
+static void lat_record(enum lat_stage stage, uint16_t t) {
+	uint16_t bound = LAT_BIN0;
+	uint8_t bin = 0;
+	
+	if(lat_acc[stage].count == 0xffff) return;	// full; reset to keep going
+	
+	if(lat_acc[stage].count == 0 || t < lat_acc[stage].min) lat_acc[stage].min = t;
+	if(t > lat_acc[stage].max) lat_acc[stage].max = t;
+	lat_acc[stage].sum += t;
+	lat_acc[stage].count++;
+	
+	while(bin < LAT_NBINS - 1 && t >= bound) {
+		bound <<= 1;
+		bin++;
+	}
+	lat_acc[stage].hist[bin]++;
+}
+
+#endif
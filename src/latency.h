@@ -0,0 +1,95 @@
+/*
+ * latency.h - Optional input-to-output latency statistics for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Build with -DLATENCY to measure how long an input takes to take effect.
+ * Each queued input event is stamped when it is detected.  When the UI
+ * takes the event, and when the first pot update and display burst
+ * queued after that have been sent, the time since that stamp is
+ * recorded for the stage.  Times
+ * are in microseconds from Timer1, and saturate at 65535.  Without
+ * LATENCY the macros compile to nothing.
+ */ 
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+enum lat_stage {
+	LAT_DISPATCH,		// event taken from the queue by the UI
+	LAT_POTS,			// pots written
+	LAT_VFD,			// display frame written
+	LAT_NSTAGES
+};
+
+#define LAT_NBINS 8			// histogram bins per stage
+#define LAT_BIN0 256		// first bin's upper bound in microseconds; each next bin doubles it
+
+#ifdef LATENCY
+
+// when an event was detected
+struct lat_stamp {
+	uint16_t tick;		// tick_now()
+	uint16_t us;		// TCNT1
+};
+
+// statistics for one stage, in microseconds
+struct lat_stats {
+	uint16_t min;
+	uint16_t max;
+	uint16_t mean;
+	uint16_t count;				// events recorded (saturates)
+	uint16_t hist[LAT_NBINS];	// bin i counts times below LAT_BIN0 << i; the last bin takes the rest
+};
+
+// stamps an event with the current time; safe in interrupt context
+void lat_now(volatile struct lat_stamp * stamp);
+
+// records the dispatch of an event and starts timing its later stages
+void lat_dispatch(const volatile struct lat_stamp * stamp);
+
+/* notes that a transfer for a stage of the current event has been queued,
+   if none has been yet.  Interrupts must be disabled. */
+void lat_start(enum lat_stage stage);
+
+/* records a stage of the current event if lat_start() noted its transfer,
+   once that is sent.  Call it from the transfer's completion with
+   interrupts disabled. */
+void lat_mark(enum lat_stage stage);
+
+// gets the statistics recorded for a stage
+void lat_getstats(enum lat_stage stage, struct lat_stats * stats);
+
+// clears all statistics
+void lat_reset();
+
+#define LAT_STAMP(stamp) lat_now(&(stamp))
+#define LAT_DISPATCH(stamp) lat_dispatch(&(stamp))
+#define LAT_START(stage) lat_start(stage)
+#define LAT_MARK(stage) lat_mark(stage)
+
+#else
+
+#define LAT_STAMP(stamp)
+#define LAT_DISPATCH(stamp)
+#define LAT_START(stage)
+#define LAT_MARK(stage)
+
+#endif
+
+#endif /* LATENCY_H_ */
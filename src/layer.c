@@ -0,0 +1,81 @@
+/*
+ * layer.c - Display compositor for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Layers are drawn bottom to top into the framebuffer, starting from the
+ * topmost opaque one since everything under it would be overwritten.
+ * Overlays that are not opaque only draw the cells they use.
+ */ 
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vfd.h"
+#include "tick.h"
+#include "layer.h"
+
+// layers that draw every cell
+#define LAYER_OPAQUE ((1<<LAYER_BASE) | (1<<LAYER_VOLUME) | (1<<LAYER_TONE))
+
+struct layer {
+	layer_draw_t draw;		// NULL while hidden
+	uint16_t shown;			// tick the layer was shown at
+	uint16_t time;			// ticks to show it for (0: until hidden)
+};
+
+static struct layer layers[LAYER_N];
+static uint8_t layer_dirty = 1;		// nonzero if the frame needs composing
+
+void layer_show(enum layer_id id, layer_draw_t draw, uint16_t ms) {
+	layers[id].draw = draw;
+	layers[id].shown = tick_now();
+	layers[id].time = ms;
+	layer_dirty = 1;
+}
+
+void layer_hide(enum layer_id id) {
+	if(layers[id].draw != NULL) {
+		layers[id].draw = NULL;
+		layer_dirty = 1;
+	}
+}
+
+void layer_invalidate() {
+	layer_dirty = 1;
+}
+
+void layer_update() {
+	uint16_t now = tick_now();
+	uint8_t i;
+	uint8_t bottom = 0;
+	
+	for(i = 0; i < LAYER_N; i++) {
+		if(layers[i].draw != NULL && layers[i].time != 0
+			&& (uint16_t)(now - layers[i].shown) >= layers[i].time) {
+			layer_hide(i);				// expired
+		}
+	}
+	if(!layer_dirty) return;
+	layer_dirty = 0;
+	
+	for(i = 0; i < LAYER_N; i++) {
+		if(layers[i].draw != NULL && (LAYER_OPAQUE & (1<<i))) bottom = i;
+	}
+	for(i = bottom; i < LAYER_N; i++) {
+		if(layers[i].draw != NULL) layers[i].draw();
+	}
+	vfd_commit();
+}
@@ -0,0 +1,57 @@
+/*
+ * layer.h - Display compositor for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * The status screen is built from layers: the input name underneath and
+ * overlays such as the volume on top, each of which can be shown for a
+ * limited time.  A frame is composed and committed only when a layer is
+ * shown, hidden or expires, so the display is left alone otherwise.
+ * Menus draw the display directly and call layer_invalidate() when they
+ * hand it back.
+ */ 
+
+#ifndef LAYER_H_
+#define LAYER_H_
+
+#include <stdint.h>
+
+enum layer_id {				// bottom to top
+	LAYER_BASE,				// current input name
+	LAYER_VOLUME,			// volume and bar graph
+	LAYER_TONE,				// bass and treble
+	LAYER_MUTE,				// mute icon in the last cell
+	LAYER_N
+};
+
+// draws a layer into the framebuffer
+typedef void (*layer_draw_t)();
+
+/* shows a layer drawn by draw for ms milliseconds (0: until hidden), or
+   restarts its time if it is already shown */
+void layer_show(enum layer_id id, layer_draw_t draw, uint16_t ms);
+
+// hides a layer
+void layer_hide(enum layer_id id);
+
+// makes the next layer_update() compose a frame, e.g. after a menu
+void layer_invalidate();
+
+/* expires layers and composes and commits a frame if anything changed.
+   Call from the UI loop. */
+void layer_update();
+
+#endif /* LAYER_H_ */
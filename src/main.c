@@ -27,9 +27,13 @@
 #include <util/delay.h>
 #include <avr/interrupt.h>
 #include "vfd.h"
+#include "spi.h"
+#include "glyph.h"
 #include "preamp.h"
 #include "ui.h"
 #include "buttons.h"
+#include "tick.h"
+#include "remote.h"
 
 static void init() {
 	DDRB = 0x00;		// start with non-destructive port settings
@@ -42,9 +46,18 @@ static void init() {
 	DDRB |= 1<<EE_LED;		// make EEPROM access LED output
 	PORTB &= ~(1<<EE_LED);	// turn off LED
 	
+	glyphinit();		// no user characters loaded yet
 	vfdinit();			// start up VFD
 	preinit();			// start up preamp controls
 	butinit();			// set up button sensing
+	reminit();			// set up IR receiver
+	if(vfd_getspispeed() == SPI_SPEEDUNKNOWN) {
+		vfd_calibrate();	// first start: find the fastest SPI clocks (times with Timer1, so after reminit)
+	}
+	if(pre_getspispeed() == SPI_SPEEDUNKNOWN) {
+		pre_calibrate();
+	}
+	tickinit();			// start sampling encoders
 	uiinit();			// set up the UI and its interrupts
 	
 	//vfdinit();			// re-init VFD to fix problems due to ArduinoISP
@@ -43,6 +43,13 @@
 #define PINC_ENCMASK ((1<<PINC_VOLUP)|(1<<PINC_VOLDN)| \
 					  (1<<PINC_LEFT)|(1<<PINC_RIGHT))
 
+// on PORTD
+#define USPI_TXD 1	// TXD0, SI of the pots with POT_USART
+#define USPI_XCK 4	// XCK0, SCK of the pots with POT_USART
+
+// PCINT for PORTB
+#define PCI0_SCK PCINT5		// wakes the SPI queue when a handshaking device lets go of SCK
+
 // PCINT for PORTC
 #define PCI1_ENTER PCINT8
 #define PCI1_BACK PCINT9
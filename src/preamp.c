@@ -34,7 +34,12 @@
  *   |_____|------------|_____|------|______|------|______|X
  *
  * Of course, all three digital potentiometers should be connected to
- * the same SCK pin of the AVR.
+ * the same SCK pin of the AVR.  If the treble pot's SO is wired to MISO,
+ * build with -DPOT_READBACK so pre_calibrate() can check its speed.
+ *
+ * Volume and tone changes are ramped: the pot codes they call for are
+ * targets, and the tick walks the wipers towards them a few codes at a
+ * time so large jumps (accelerated spins, muting) don't click.
  *
  * TODO: Headphone detection and speaker control are not yet implemented.
  * TODO: Tone behavior
@@ -45,20 +50,32 @@
 #include <util/delay.h>
 #include <avr/eeprom.h>
 #include <avr/pgmspace.h>
+#include <util/atomic.h>
 #include <stdint.h>
 #include "pins.h"
 #include "preamp.h"
 #include "spi.h"
+#include "uspi.h"
+#include "bench.h"
+#include "latency.h"
+#include "eedata.h"
 
 #define PRE_NINPUTS 8
 #define PRE_MINTONE (-12)
 #define PRE_MAXTONE 12
-#define PRE_MAXVOL 38
 
 #define POT_NOP 0
 #define POT_WRITE (1<<4)
 #define POT_BOTH 3
 
+#define PRE_SPIDEFAULT 1	// SPI speed (F_CPU/4) until calibrated
+
+#define PRE_RAMPTIME 4		// ms between ramp steps
+
+#if defined(POT_READBACK) && !defined(POT_USART)
+#define PRE_PROBE			// pots can be read back on the SPI bus
+#endif
+
 // logarithmic volume curve
 // as determined in "/misc/volume pot curve.xlsx"
 static const uint8_t PROGMEM pre_volcurve[39] = {
@@ -81,6 +98,7 @@ static enum pre_tonebehavior ee_tonebehavior EEMEM = TONE_SPKONLY;
 static int8_t ee_bass EEMEM = 0;
 static int8_t ee_treb EEMEM = 0;
 static enum pre_spkbehavior ee_spkbehavior EEMEM = SPK_AUTO;
+// the SPI speed and ramp step are in ee_data
 
 // Volatile copies
 static uint8_t ram_volume = 0;
@@ -89,21 +107,80 @@ static enum pre_tonebehavior ram_tonebehavior = TONE_SPKONLY;
 static enum pre_spkbehavior ram_spkbehavior = SPK_AUTO;
 static int8_t ram_bass = 0;
 static int8_t ram_treb = 0;
+static uint8_t ram_spispeed = SPI_SPEEDUNKNOWN;
+static uint8_t ram_ramp = PRE_RAMPDEFAULT;	// pot codes per ramp step (0: no ramp)
+static uint8_t ram_muted = 0;
+
+/*
+ * Ramp.  Settings set pre_target, the pot codes they call for, and the
+ * tick moves pre_wiper, the codes the pots are sent, up to ram_ramp codes
+ * towards them every PRE_RAMPTIME ticks.  A new target takes over from
+ * wherever the wipers are.  Wipers start at the default settings' codes.
+ */
+enum pre_pot {		// in transfer order
+	PRE_TREB,
+	PRE_BASS,
+	PRE_VOL,
+	PRE_NPOTS
+};
+static uint8_t pre_target[PRE_NPOTS] = {128, 128, 0};
+static uint8_t pre_wiper[PRE_NPOTS] = {128, 128, 0};
+static volatile uint8_t pre_ramping = 0;	// nonzero while a wiper is short of its target
+static uint8_t pre_ramptime;				// ticks until the next step
+
+#ifdef PRE_PROBE
+// NOP commands (C1:C0 = 00) shifted through the chain to check the clock
+static const uint8_t PROGMEM pre_pattern[6] = {
+	0xc5, 0x5a, 0x0a, 0xa5, 0xcf, 0x3c
+};
+#endif
+
+/*
+ * Pot updates are queued on the SPI bus and sent by its interrupt.  A
+ * change made while one is going out is sent straight after it.
+ * POT_USART builds send them on USART0 instead, clear of the display.
+ */
+#ifdef POT_USART
+#define pre_submit(xfer) uspi_submit(xfer)
+#else
+#define pre_submit(xfer) spi_submit(xfer)
+#endif
+
+static struct spi_device pre_spi = SPI_DEVICE(POT_CS, SPI_MSBFIRST, SPI_MODE0, SPI_CKDIV4, 0);
+static uint8_t pre_potbuf[6];			// command and value for each pot
+static void pre_potssent(struct spi_xfer * xfer);
+static struct spi_xfer pre_xfer = {&pre_spi, pre_potbuf, sizeof(pre_potbuf), pre_potssent};
+static volatile uint8_t pre_potbusy = 0;	// nonzero while an update is queued or being sent
+static volatile uint8_t pre_potagain = 0;	// nonzero if the settings changed meanwhile
+#ifdef BENCH
+static uint16_t pre_potstart;			// when the update being sent was queued
+#endif
 
 static void pre_load();
 static void pre_updatepots();
+static void pre_retarget();
+static void pre_rampstep();
+static void pre_waitpots();
+static void pre_fillpots(uint8_t * buf);
+#ifdef PRE_PROBE
+static uint8_t pre_probe(uint8_t speed);
+#endif
+static int8_t pre_clamptone(int16_t tone);
 
 void preinit() {
-	PORTB |= 1<<POT_CS;	// Pot CS is high
-	DDRB |= 1<<POT_CS;	// pot CS is output
+	spi_devinit(&pre_spi);	// pot CS is high until a transfer
+#ifdef POT_USART
+	uspiinit();
+#endif
 	
 	pre_updatepots();	// set pots to their default values
+	pre_waitpots();		// before the caps charge, or they thump
 	
 	pre_load();
 	
 	_delay_ms(3000);	// wait for caps to charge
 	
-	pre_updatepots();	// set pots to loaded volume settings
+	pre_retarget();		// ramp pots up to loaded volume settings
 }
 
 /*
@@ -116,6 +193,14 @@ static void pre_load() {
 	eeprom_read_block(&ram_treb, &ee_treb, sizeof(ee_treb));
 	eeprom_read_block(&ram_tonebehavior, &ee_tonebehavior, sizeof(ee_tonebehavior));
 	eeprom_read_block(&ram_spkbehavior, &ee_spkbehavior, sizeof(ee_spkbehavior));
+	ram_ramp = eeprom_read_byte(&ee_data.ramp);
+	if(ram_ramp > PRE_MAXRAMP) ram_ramp = PRE_RAMPDEFAULT;
+	ram_spispeed = eeprom_read_byte(&ee_data.potspispeed);
+	if(ram_spispeed < SPI_NSPEEDS) {
+		spi_setspeed(&pre_spi, ram_spispeed);
+	} else {
+		ram_spispeed = SPI_SPEEDUNKNOWN;	// not calibrated yet: keep the default
+	}
 }
 
 /*
@@ -129,6 +214,7 @@ void pre_save() {
 	eeprom_update_block(&ram_treb, &ee_treb, sizeof(ee_treb));
 	eeprom_update_block(&ram_tonebehavior, &ee_tonebehavior, sizeof(ee_tonebehavior));
 	eeprom_update_block(&ram_spkbehavior, &ee_spkbehavior, sizeof(ee_spkbehavior));
+	eeprom_update_byte(&ee_data.ramp, ram_ramp);
 	PORTB &= ~(1<<EE_LED);	// turn off EEPROM access LED
 }
 
@@ -155,7 +241,7 @@ enum pre_tonebehavior pre_increasetonebehavior() {
 		ram_tonebehavior = TONE_ALWAYS;
 		break;
 	}
-	pre_updatepots();
+	pre_retarget();
 	return ram_tonebehavior;
 }
 
@@ -175,7 +261,7 @@ enum pre_tonebehavior pre_decreasetonebehavior() {
 		ram_tonebehavior = TONE_SPKONLY;
 		break;
 	}
-	pre_updatepots();
+	pre_retarget();
 	return ram_tonebehavior;
 }
 
@@ -191,10 +277,7 @@ int8_t pre_getbass() {
  * returns the new bass setting
  */
 int8_t pre_increasebass() {
-	ram_bass++;
-	if(ram_bass > PRE_MAXTONE) ram_bass = PRE_MAXTONE;
-	pre_updatepots();
-	return ram_bass;
+	return pre_changebass(1);
 }
 
 /*
@@ -202,9 +285,16 @@ int8_t pre_increasebass() {
  * returns the new bass setting
  */
 int8_t pre_decreasebass() {
-	ram_bass--;
-	if(ram_bass < PRE_MINTONE) ram_bass = PRE_MINTONE;
-	pre_updatepots();
+	return pre_changebass(-1);
+}
+
+/*
+ * changes the bass setting by delta steps with a single pot update
+ * returns the new bass setting
+ */
+int8_t pre_changebass(int8_t delta) {
+	ram_bass = pre_clamptone(ram_bass + delta);
+	pre_retarget();
 	return ram_bass;
 }
 
@@ -220,10 +310,7 @@ int8_t pre_gettreb() {
  * returns the new bass setting
  */
 int8_t pre_increasetreb() {
-	ram_treb++;
-	if(ram_treb > PRE_MAXTONE) ram_treb = PRE_MAXTONE;
-	pre_updatepots();
-	return ram_treb;
+	return pre_changetreb(1);
 }
 
 /*
@@ -231,12 +318,28 @@ int8_t pre_increasetreb() {
  * returns the new treble setting
  */
 int8_t pre_decreasetreb() {
-	ram_treb--;
-	if(ram_treb < PRE_MINTONE) ram_treb = PRE_MINTONE;
-	pre_updatepots();
+	return pre_changetreb(-1);
+}
+
+/*
+ * changes the treble setting by delta steps with a single pot update
+ * returns the new treble setting
+ */
+int8_t pre_changetreb(int8_t delta) {
+	ram_treb = pre_clamptone(ram_treb + delta);
+	pre_retarget();
 	return ram_treb;
 }
 
+/*
+ * limits a tone setting to PRE_MINTONE..PRE_MAXTONE
+ */
+static int8_t pre_clamptone(int16_t tone) {
+	if(tone < PRE_MINTONE) return PRE_MINTONE;
+	if(tone > PRE_MAXTONE) return PRE_MAXTONE;
+	return tone;
+}
+
 /*
  * Increases the speaker behavior setting
  * Returns new speaker behavior
@@ -321,10 +424,7 @@ uint8_t pre_previnput() {
  * returns new volume.
  */
 uint8_t pre_increasevol() {
-	ram_volume++;
-	if(ram_volume > PRE_MAXVOL) ram_volume = PRE_MAXVOL;
-	pre_updatepots();
-	return ram_volume;
+	return pre_changevol(1);
 }
 
 /*
@@ -332,31 +432,253 @@ uint8_t pre_increasevol() {
  * returns new volume.
  */
 uint8_t pre_decreasevol() {
-	if(ram_volume > 0) ram_volume--;
-	pre_updatepots();
+	return pre_changevol(-1);
+}
+
+/*
+ * Changes volume by delta steps with a single ramp, unmuting.
+ * returns new volume.
+ */
+uint8_t pre_changevol(int8_t delta) {
+	int16_t newvol = ram_volume + delta;
+	
+	if(newvol < 0) newvol = 0;
+	if(newvol > PRE_MAXVOL) newvol = PRE_MAXVOL;
+	ram_volume = newvol;
+	ram_muted = 0;
+	pre_retarget();
+	return ram_volume;
+}
+
+/*
+ * gets the volume
+ * zero to PRE_MAXVOL
+ */
+uint8_t pre_getvol() {
 	return ram_volume;
 }
 
 /*
- * Updates the pots according to the ram_vol, ram_bass, and ram_treb settings
+ * Mutes (nonzero) or unmutes, ramping the volume down to nothing or back
+ */
+void pre_setmute(uint8_t muted) {
+	ram_muted = muted;
+	pre_retarget();
+}
+
+/*
+ * gets whether the preamp is muted
+ */
+uint8_t pre_getmute() {
+	return ram_muted;
+}
+
+/*
+ * gets the ramp step, in pot codes (0: changes are not ramped)
+ */
+uint8_t pre_getramp() {
+	return ram_ramp;
+}
+
+/*
+ * makes ramps steeper, if possible
+ * returns the new ramp step
+ */
+uint8_t pre_increaseramp() {
+	if(ram_ramp < PRE_MAXRAMP) ram_ramp++;
+	return ram_ramp;
+}
+
+/*
+ * makes ramps gentler, down to no ramp at all
+ * returns the new ramp step
+ */
+uint8_t pre_decreaseramp() {
+	if(ram_ramp > 0) ram_ramp--;
+	return ram_ramp;
+}
+
+/*
+ * Sets the wiper targets from the ram_vol, ram_bass, and ram_treb settings.
+ * If the wipers are at rest, the first step goes out at once; a ramp
+ * already running heads for the new targets from its next step.
  * TODO: Implement tone behavior
  */
+static void pre_retarget() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// the tick steps the wipers
+		pre_target[PRE_TREB] = pgm_read_byte(&(pre_tonecurve[ram_treb-PRE_MINTONE]));
+		pre_target[PRE_BASS] = pgm_read_byte(&(pre_tonecurve[ram_bass-PRE_MINTONE]));
+		pre_target[PRE_VOL] = ram_muted ? 0 : pgm_read_byte(&(pre_volcurve[ram_volume]));
+		if(!pre_ramping) {
+			pre_ramptime = PRE_RAMPTIME;
+			pre_rampstep();
+		}
+	}
+}
+
+/*
+ * Moves each wiper up to ram_ramp codes towards its target and updates
+ * the pots if any moved.  Interrupts must be disabled, or it must be
+ * called from the tick.
+ */
+static void pre_rampstep() {
+	uint8_t moved = 0;
+	uint8_t i;
+	
+	pre_ramping = 0;
+	for(i = 0; i < PRE_NPOTS; i++) {
+		uint8_t w = pre_wiper[i];
+		uint8_t t = pre_target[i];
+		
+		if(w == t) continue;
+		if(ram_ramp == 0) {
+			w = t;
+		} else if(w < t) {
+			w = (t - w > ram_ramp) ? w + ram_ramp : t;
+		} else {
+			w = (w - t > ram_ramp) ? w - ram_ramp : t;
+		}
+		pre_wiper[i] = w;
+		moved = 1;
+		if(w != t) pre_ramping = 1;
+	}
+	if(moved) pre_updatepots();
+}
+
+/*
+ * Steps a running ramp; called from the tick interrupt, which may be
+ * interrupted by the SPI interrupt
+ */
+void pre_tick() {
+	if(!pre_ramping) return;
+	if(--pre_ramptime != 0) return;
+	pre_ramptime = PRE_RAMPTIME;
+	pre_rampstep();
+}
+
+/*
+ * Sends the wipers to the pots
+ */
 static void pre_updatepots() {
-	uint8_t volpot_val, trebpot_val, basspot_val;// stores calculated pot codes
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// the SPI interrupt may be finishing the last update
+		if(pre_potbusy) {
+			pre_potagain = 1;		// send the latest values once it is done
+		} else {
+			pre_potbusy = 1;
+			pre_fillpots(pre_potbuf);
+			BENCH_STAMP(pre_potstart);
+			LAT_START(LAT_POTS);
+			pre_submit(&pre_xfer);
+		}
+	}
+}
+
+/*
+ * Fills a 6-byte pot transfer with the wipers.  Interrupts must be
+ * disabled.
+ */
+static void pre_fillpots(uint8_t * buf) {
+	buf[0] = POT_WRITE|POT_BOTH;
+	buf[1] = pre_wiper[PRE_TREB];	// to pot 3 (treb)
+	buf[2] = POT_WRITE|POT_BOTH;
+	buf[3] = pre_wiper[PRE_BASS];	// to pot 2 (bass)
+	buf[4] = POT_WRITE|POT_BOTH;
+	buf[5] = pre_wiper[PRE_VOL];	// to pot 1 (vol)
+}
+
+/*
+ * Waits until the pots have their values.  Before interrupts are enabled
+ * at startup, it drives the SPI (or USART) queue itself.
+ */
+static void pre_waitpots() {
+	while(pre_potbusy) {
+		if(!(SREG & (1<<SREG_I))) {
+#ifdef POT_USART
+			uspi_poll();
+#else
+			spi_poll();
+#endif
+		}
+	}
+}
+
+/*
+ * Called from the SPI (or USART) interrupt once the pots have their values
+ */
+static void pre_potssent(struct spi_xfer * xfer) {
+	BENCH_SINCE(BENCH_POTXFER, pre_potstart);
+	LAT_MARK(LAT_POTS);
+	if(pre_potagain) {
+		pre_potagain = 0;
+		pre_fillpots(pre_potbuf);
+		BENCH_STAMP(pre_potstart);
+		LAT_START(LAT_POTS);
+		pre_submit(xfer);
+	} else {
+		pre_potbusy = 0;
+	}
+}
+
+/*
+ * gets the pots' SPI speed, or SPI_SPEEDUNKNOWN if it has not been calibrated
+ */
+uint8_t pre_getspispeed() {
+	return ram_spispeed;
+}
+
+/*
+ * Finds the fastest SCK the pots take and saves it.  POT_READBACK builds
+ * try each speed, fastest first, and take the first that passes
+ * pre_probe().  Otherwise the pots can't be checked, so their speed is
+ * left as it is rather than saving one nothing has verified.  POT_USART
+ * builds leave the SPI speed alone; USART0 already runs at F_CPU/2.
+ * Returns the speed chosen, or SPI_SPEEDUNKNOWN if the pots can't be
+ * checked.
+ */
+uint8_t pre_calibrate() {
+#if defined(POT_USART)
+	return 0;
+#elif !defined(PRE_PROBE)
+	return SPI_SPEEDUNKNOWN;
+#else
+	uint8_t speed = 0;
+	
+	while(speed < SPI_NSPEEDS && !pre_probe(speed)) speed++;
+	if(speed >= SPI_NSPEEDS) speed = PRE_SPIDEFAULT;	// nothing came back
+	ram_spispeed = speed;
+	spi_setspeed(&pre_spi, speed);
 	
-	// convert ram_vol, ram_bass, ram_treb to pot codes
-	volpot_val = pgm_read_byte(&(pre_volcurve[ram_volume]));
-	trebpot_val = pgm_read_byte(&(pre_tonecurve[ram_treb-PRE_MINTONE]));
-	basspot_val = pgm_read_byte(&(pre_tonecurve[ram_bass-PRE_MINTONE]));
+	PORTB |= 1<<EE_LED;		// turn on EEPROM access LED
+	eeprom_update_byte(&ee_data.potspispeed, ram_spispeed);
+	PORTB &= ~(1<<EE_LED);	// turn off EEPROM access LED
+	return speed;
+#endif
+}
+
+#ifdef PRE_PROBE
+/*
+ * Shifts pre_pattern into the chain at a speed, then the current
+ * settings behind it, which push the pattern out of the treble pot's SO
+ * and are what the pots act on when CS rises.
+ * Returns nonzero if the pattern came back intact.
+ */
+static uint8_t pre_probe(uint8_t speed) {
+	uint8_t settings[6];
+	uint8_t ok = 1;
+	uint8_t i;
 	
-	// push values out to pots
-	spiinit(SPI_MSBFIRST, SPI_MODE0, SPI_CKDIV4);// set pot spi mode
-	PORTB &= ~(1<<POT_CS);	// enable pot CS
-	spi_transfer(POT_WRITE|POT_BOTH);
-	spi_transfer(trebpot_val);	// send to pot 3 (treb)
-	spi_transfer(POT_WRITE|POT_BOTH);
-	spi_transfer(basspot_val);	// send to pot 2 (bass)
-	spi_transfer(POT_WRITE|POT_BOTH);
-	spi_transfer(volpot_val);	// send to pot 1 (vol)
-	PORTB |= 1<<POT_CS;		// disable pot CS
-}
\ No newline at end of file
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// the tick may be ramping
+		pre_fillpots(settings);
+	}
+	spi_setspeed(&pre_spi, speed);
+	spi_begin(&pre_spi);		// waits for any queued update to finish
+	for(i = 0; i < sizeof(settings); i++) {
+		spi_transfer(pgm_read_byte(&pre_pattern[i]));
+	}
+	for(i = 0; i < sizeof(settings); i++) {
+		if((uint8_t)spi_transfer(settings[i]) != pgm_read_byte(&pre_pattern[i])) ok = 0;
+	}
+	spi_end(&pre_spi);
+	return ok;
+}
+#endif
@@ -21,6 +21,10 @@
 #ifndef PREAMP_H_
 #define PREAMP_H_
 
+#define PRE_MAXVOL 38		// highest volume setting
+#define PRE_MAXRAMP 32		// steepest ramp step, in pot codes
+#define PRE_RAMPDEFAULT 4	// default ramp step, in pot codes
+
 enum pre_spkbehavior {
 	SPK_AUTO,
 	SPK_ON,
@@ -43,6 +47,18 @@ void preinit();
  */
 void pre_save();
 
+/*
+ * Finds and saves the fastest SPI speed the pots take (see spi_setspeed()).
+ * returns the speed chosen, or SPI_SPEEDUNKNOWN if the pots can't be
+ * checked (built without POT_READBACK), in which case nothing is saved.
+ */
+uint8_t pre_calibrate();
+
+/*
+ * gets the pots' SPI speed, or SPI_SPEEDUNKNOWN if it has not been calibrated
+ */
+uint8_t pre_getspispeed();
+
 /*
  * Increments volume. volume max is 64
  * returns new volume.
@@ -55,6 +71,53 @@ uint8_t pre_increasevol();
  */
 uint8_t pre_decreasevol();
 
+/*
+ * Changes volume by delta steps (negative to decrease) with a single
+ * pot update.  Volume is clamped to its range.
+ * returns new volume.
+ */
+uint8_t pre_changevol(int8_t delta);
+
+/*
+ * gets the volume
+ * zero to PRE_MAXVOL
+ */
+uint8_t pre_getvol();
+
+/*
+ * Mutes (nonzero) or unmutes, ramping the volume down to nothing or back.
+ * Changing the volume also unmutes.
+ */
+void pre_setmute(uint8_t muted);
+
+/*
+ * gets whether the preamp is muted
+ */
+uint8_t pre_getmute();
+
+/*
+ * gets the ramp step: how many pot codes volume and tone changes move
+ * per step, every few milliseconds (0: changes are not ramped)
+ */
+uint8_t pre_getramp();
+
+/*
+ * makes ramps steeper, up to PRE_MAXRAMP
+ * returns the new ramp step
+ */
+uint8_t pre_increaseramp();
+
+/*
+ * makes ramps gentler, down to no ramp at all
+ * returns the new ramp step
+ */
+uint8_t pre_decreaseramp();
+
+/*
+ * steps any running ramp; called from the tick interrupt
+ */
+void pre_tick();
+
 /*
  * jumps to the next input
  * returns new input number
@@ -90,6 +153,12 @@ int8_t pre_increasebass();
  */
 int8_t pre_decreasebass();
 
+/*
+ * changes the bass setting by delta steps with a single pot update
+ * returns the new bass setting
+ */
+int8_t pre_changebass(int8_t delta);
+
 /*
  * gets the treble setting
  */
@@ -107,6 +176,12 @@ int8_t pre_increasetreb();
  */
 int8_t pre_decreasetreb();
 
+/*
+ * changes the treble setting by delta steps with a single pot update
+ * returns the new treble setting
+ */
+int8_t pre_changetreb(int8_t delta);
+
 /*
  * Gets the tone behavior
  */
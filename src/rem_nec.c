@@ -0,0 +1,122 @@
+/*
+ * rem_nec.c - NEC IR decoder for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * A frame is a 9 ms header mark, a 4.5 ms space, then 32 bits LSB first:
+ * address, inverted address (or the high byte of a 16-bit extended
+ * address), command and inverted command.  Each bit is a 560 us mark and
+ * a 560 us (zero) or 1690 us (one) space; a final 560 us mark ends the
+ * frame.  While the key is held, the remote sends only a repeat code
+ * (9 ms mark, 2.25 ms space, 560 us mark) about every 110 ms.
+ */ 
+
+#include <stdint.h>
+#include "remote.h"
+
+#ifdef REM_USE_NEC
+
+enum nec_state {
+	NEC_IDLE,		// waiting for a header mark
+	NEC_HEADER,		// header mark seen, waiting for its space
+	NEC_DATA,		// receiving bits
+	NEC_REPEAT		// repeat space seen, waiting for its closing mark
+};
+
+static uint32_t nec_packet;			// bits received so far, shifted in from the top
+static uint8_t nec_bit;				// number of bits received
+static enum nec_state nec_state = NEC_IDLE;
+static uint8_t nec_valid = 0;		// nonzero if nec_last holds a received key
+static struct rem_code nec_last;	// last full frame, for repeat codes
+
+static void nec_frame();
+
+void nec_edge(uint8_t mark, uint16_t length) {
+	if(mark) {
+		if(length >= 8000 && length <= 10000) {		// header mark
+			nec_state = NEC_HEADER;
+		} else if(length < 400 || length > 750) {	// not a bit or stop mark
+			if(nec_state == NEC_DATA) REM_REJECTED(REM_PROTO_NEC);
+			nec_state = NEC_IDLE;
+		} else if(nec_state == NEC_REPEAT) {		// repeat code complete
+			if(nec_valid) rem_received(&nec_last, REM_REPEAT);
+			nec_state = NEC_IDLE;
+		}
+		return;
+	}
+	
+	switch(nec_state) {
+	case NEC_HEADER:
+		if(length >= 4000 && length <= 5000) {		// frame
+			nec_bit = 0;
+			nec_state = NEC_DATA;
+		} else if(length >= 2000 && length <= 2500) {// repeat code
+			nec_state = NEC_REPEAT;
+		} else {
+			nec_state = NEC_IDLE;
+		}
+		break;
+	case NEC_DATA:
+		nec_packet >>= 1;
+		if(length >= 1400 && length <= 1900) {		// data one
+			nec_packet |= 1UL<<31;
+		} else if(length < 400 || length > 750) {	// not a data zero either
+			REM_REJECTED(REM_PROTO_NEC);
+			nec_state = NEC_IDLE;
+			break;
+		}
+		if(++nec_bit == 32) {						// stop mark has started
+			nec_frame();
+			nec_state = NEC_IDLE;
+		}
+		break;
+	default:
+		nec_state = NEC_IDLE;
+		break;
+	}
+}
+
+void nec_idle() {
+	if(nec_state == NEC_DATA) REM_REJECTED(REM_PROTO_NEC);	// truncated
+	nec_state = NEC_IDLE;
+}
+
+/*
+ * Checks and reports a complete 32-bit frame
+ */
+static void nec_frame() {
+	uint8_t addr = nec_packet;
+	uint8_t naddr = nec_packet >> 8;
+	uint8_t cmd = nec_packet >> 16;
+	uint8_t ncmd = nec_packet >> 24;
+	
+	if((uint8_t)~cmd != ncmd) {			// corrupt
+		REM_REJECTED(REM_PROTO_NEC);
+		return;
+	}
+	
+	nec_last.protocol = REM_PROTO_NEC;
+	nec_last.command = cmd;
+	if((uint8_t)~addr == naddr) {		// standard 8-bit address
+		nec_last.address = addr;
+	} else {							// extended 16-bit address
+		nec_last.address = ((uint16_t)naddr << 8) | addr;
+	}
+	nec_valid = 1;
+	rem_received(&nec_last, REM_NEWPRESS);	// NEC sends a full frame only once per press
+}
+
+#endif
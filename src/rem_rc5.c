@@ -0,0 +1,139 @@
+/*
+ * rem_rc5.c - Philips RC5 decoder for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * A frame is 14 Manchester-coded bits of 1.778 ms, MSB first: two start
+ * bits, a toggle bit, 5 address bits and 6 command bits.  A one is a half
+ * bit of space then a half bit of mark; a zero is the reverse.  In RC5X the
+ * second start bit is the inverted seventh command bit.  The toggle bit
+ * flips on every new key press, so frames repeated while a key is held
+ * (about every 114 ms) keep it.
+ *
+ * Decoding follows the mid-bit transitions: from the middle of a bit, a
+ * short interval reaches the next bit boundary and a long one reaches the
+ * middle of the next bit, whose value is then known.
+ */ 
+
+#include <stdint.h>
+#include "remote.h"
+
+#ifdef REM_USE_RC5
+
+#define RC5_BITS 14
+#define RC5_MINBITS 4	// bits before a broken frame counts as an error rather than noise
+
+enum rc5_state {
+	RC5_IDLE,		// waiting for the first mark
+	RC5_MID1,		// middle of a one (in a mark)
+	RC5_START1,		// start of a one (in a space)
+	RC5_MID0,		// middle of a zero (in a space)
+	RC5_START0		// start of a zero (in a mark)
+};
+
+static uint16_t rc5_packet;			// bits received so far
+static uint8_t rc5_bit;				// number of bits received
+static enum rc5_state rc5_state = RC5_IDLE;
+static uint8_t rc5_toggle = 0xff;	// toggle bit of the last frame (0xff: none)
+
+static void rc5_frame();
+static void rc5_abort();
+
+void rc5_edge(uint8_t mark, uint16_t length) {
+	uint8_t half;		// 1 = short interval, 2 = long interval
+	
+	if(rc5_state == RC5_IDLE) {
+		if(!mark) {		// first mark starts mid-way through the first start bit
+			rc5_packet = 1;
+			rc5_bit = 1;
+			rc5_state = RC5_MID1;
+		}
+		return;
+	}
+	
+	if(length >= 640 && length <= 1140) {
+		half = 1;
+	} else if(length >= 1340 && length <= 2000) {
+		half = 2;
+	} else {
+		rc5_abort();
+		return;
+	}
+	
+	// every state expects one kind of interval to end; anything else is an error
+	switch(rc5_state) {
+	case RC5_MID1:
+		if(!mark) half = 0;
+		rc5_state = (half == 1) ? RC5_START1 : RC5_MID0;
+		break;
+	case RC5_START1:
+		if(mark || half != 1) half = 0;
+		rc5_state = RC5_MID1;
+		break;
+	case RC5_MID0:
+		if(mark) half = 0;
+		rc5_state = (half == 1) ? RC5_START0 : RC5_MID1;
+		break;
+	case RC5_START0:
+		if(!mark || half != 1) half = 0;
+		rc5_state = RC5_MID0;
+		break;
+	default:
+		half = 0;
+		break;
+	}
+	
+	if(half == 0) {
+		rc5_abort();
+		return;
+	}
+	
+	if(rc5_state == RC5_MID1 || rc5_state == RC5_MID0) {	// reached the middle of a bit
+		rc5_packet = (rc5_packet << 1) | (rc5_state == RC5_MID1);
+		if(++rc5_bit == RC5_BITS) {
+			rc5_frame();
+			rc5_state = RC5_IDLE;
+		}
+	}
+}
+
+void rc5_idle() {
+	if(rc5_state != RC5_IDLE) rc5_abort();	// truncated
+}
+
+/*
+ * Drops the frame in progress
+ */
+static void rc5_abort() {
+	if(rc5_bit >= RC5_MINBITS) REM_REJECTED(REM_PROTO_RC5);
+	rc5_state = RC5_IDLE;
+}
+
+/*
+ * Reports a complete 14-bit frame
+ */
+static void rc5_frame() {
+	struct rem_code code;
+	uint8_t toggle = (rc5_packet >> 11) & 1;
+	
+	code.protocol = REM_PROTO_RC5;
+	code.address = (rc5_packet >> 6) & 0x1f;
+	code.command = (rc5_packet & 0x3f) | ((~rc5_packet >> 6) & 0x40);	// RC5X: inverted start bit 2
+	rem_received(&code, (toggle == rc5_toggle) ? REM_REPEAT : REM_NEWPRESS);
+	rc5_toggle = toggle;
+}
+
+#endif
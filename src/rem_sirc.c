@@ -0,0 +1,87 @@
+/*
+ * rem_sirc.c - Sony SIRC decoder for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * A frame is a 2.4 ms header mark followed by 12, 15 or 20 data bits, LSB
+ * first, each a 0.6 ms space and a 0.6 ms (zero) or 1.2 ms (one) mark.
+ * There is no stop bit, so the length is only known once the line has
+ * been quiet for longer than a bit gap.
+ *
+ *   12 bits: 7 command, 5 address
+ *   15 bits: 7 command, 8 address
+ *   20 bits: 7 command, 5 address, 8 extended address
+ */ 
+
+#include <stdint.h>
+#include "remote.h"
+
+#ifdef REM_USE_SIRC
+
+#define SIRC_BITGAP 900		// max space between marks of a frame, in microseconds
+#define SIRC_MAXBITS 20
+#define SIRC_NOFRAME 0xff	// sirc_bit value while waiting for a header
+
+static uint32_t sirc_packet;		// bits received so far, shifted in from the top
+static uint8_t sirc_bit = SIRC_NOFRAME;	// number of bits received
+
+void sirc_edge(uint8_t mark, uint16_t length) {
+	if(!mark) {
+		if(length > SIRC_BITGAP) sirc_idle();	// previous frame (if any) is over
+		return;
+	}
+	
+	if(length >= 2100 && length <= 2700) {	// header: start a new frame
+		sirc_packet = 0;
+		sirc_bit = 0;
+		return;
+	}
+	
+	if(sirc_bit >= SIRC_MAXBITS) {		// not receiving, or too many bits
+		if(sirc_bit != SIRC_NOFRAME) REM_REJECTED(REM_PROTO_SIRC);
+		sirc_bit = SIRC_NOFRAME;
+		return;
+	}
+	
+	sirc_packet >>= 1;
+	if(length >= 450 && length < 750) {			// data zero
+		sirc_bit++;
+	} else if(length >= 900 && length < 1500) {	// data one
+		sirc_packet |= 1UL<<(SIRC_MAXBITS - 1);
+		sirc_bit++;
+	} else {									// bad data
+		REM_REJECTED(REM_PROTO_SIRC);
+		sirc_bit = SIRC_NOFRAME;
+	}
+}
+
+void sirc_idle() {
+	struct rem_code code;
+	uint32_t packet;
+	
+	if(sirc_bit == 12 || sirc_bit == 15 || sirc_bit == 20) {
+		packet = sirc_packet >> (SIRC_MAXBITS - sirc_bit);	// align first bit to bit 0
+		code.protocol = REM_PROTO_SIRC;
+		code.command = packet & 0x7f;
+		code.address = packet >> 7;		// extended address lands above the 5-bit one
+		rem_received(&code, REM_FRAME);
+	} else if(sirc_bit != SIRC_NOFRAME) {	// wrong length
+		REM_REJECTED(REM_PROTO_SIRC);
+	}
+	sirc_bit = SIRC_NOFRAME;
+}
+
+#endif
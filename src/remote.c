@@ -0,0 +1,451 @@
+/*
+ * remote.c - IR remote control receiver for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Edge timestamping, key mapping and auto-repeat for all IR protocols.
+ * The protocol decoders live in rem_*.c.
+ */ 
+
+#if F_CPU != 1000000UL
+#error "F_CPU must be 1000000 Hz. Other CPU frequencies are not yet supported."
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include <stdint.h>
+#include "pins.h"
+#include "buttons.h"
+#include "remote.h"
+#include "bench.h"
+
+#define REM_TIMEOUT 40000U	// silence that ends a frame, in microseconds
+#define REM_NKEYS 12		// entries in rem_keymap
+#define REM_NRAMP 4			// stages in the auto-repeat ramp
+#define REM_NBINDINGS 24	// entries in the EEPROM key table
+#define REM_NSLOTS 32		// RAM hash table size, a power of two above REM_NBINDINGS
+#define REM_KEYMAPVALID 0xA5	// ee_keymapvalid once the key table has been set up
+
+// a remote key bound to a button
+struct rem_binding {
+	struct rem_code code;
+	uint8_t button;			// BUT_NONE marks an unused entry
+};
+
+/*
+ * Default keymap (Sony TV remote, address 1)
+ * Copied into the EEPROM key table when it is reset.
+ */
+static const struct rem_binding PROGMEM rem_keymap[REM_NKEYS] = {
+	{{REM_PROTO_SIRC, 1, 0x60}, BUT_ENTER},
+	{{REM_PROTO_SIRC, 1, 0x65}, BUT_ENTER},
+	{{REM_PROTO_SIRC, 1, 0x63}, BUT_BACK},
+	{{REM_PROTO_SIRC, 1, 0x12}, BUT_VOLINC},
+	{{REM_PROTO_SIRC, 1, 0x13}, BUT_VOLDEC},
+	{{REM_PROTO_SIRC, 1, 0x10}, BUT_SELDNR},
+	{{REM_PROTO_SIRC, 1, 0x11}, BUT_SELUPL},
+	{{REM_PROTO_SIRC, 1, 0x74}, BUT_DIRUP},
+	{{REM_PROTO_SIRC, 1, 0x75}, BUT_DIRDN},
+	{{REM_PROTO_SIRC, 1, 0x34}, BUT_DIRLEFT},
+	{{REM_PROTO_SIRC, 1, 0x33}, BUT_DIRRIGHT},
+	{{REM_PROTO_SIRC, 1, 0x14}, BUT_MUTE}
+};
+
+/*
+ * Auto-repeat ramp for held remote keys, slowest first.  From the given
+ * repeat frame on, every repeat frame whose number has no bits of mask set
+ * queues steps steps.  Before the first stage, held keys do not repeat.
+ * Frame numbers assume SIRC's 45 ms repeat rate; NEC and RC5 repeat about
+ * every 110 ms, so they ramp proportionally slower.
+ */
+static const struct {
+	uint8_t from;
+	uint8_t mask;
+	uint8_t steps;
+} PROGMEM rem_ramp[REM_NRAMP] = {
+	{8, 0x03, 1},	// after ~0.35 s: every 4th frame (~5/s)
+	{16, 0x01, 1},	// after ~0.7 s: every 2nd frame (~11/s)
+	{28, 0x00, 1},	// after ~1.25 s: every frame (~22/s)
+	{48, 0x00, 2}	// after ~2.2 s: 2 steps per frame (~44/s)
+};
+
+// Non-volatile key table
+static struct rem_binding ee_bindings[REM_NBINDINGS] EEMEM;
+static uint8_t ee_keymapvalid EEMEM = 0;
+
+// Volatile copy of the key table, hashed by code.  Open addressing
+// with linear probing; an unused slot ends every probe sequence.
+static struct rem_binding ram_keyhash[REM_NSLOTS];
+
+static void rem_load();
+static uint8_t rem_hash(const struct rem_code * code);
+static uint8_t rem_samecode(const struct rem_code * a, const struct rem_code * b);
+static enum but_type rem_lookup(const struct rem_code * code);
+static void rem_decode(uint8_t mark, uint16_t length);
+static void rem_idle();
+
+// receiver state, touched only by the Timer1 interrupts
+static uint16_t rem_lastedge;		// timestamp of the last receiver edge
+static uint8_t rem_held = 0;		// nonzero while a key is held down
+static uint8_t rem_holdwaits;		// timer periods of silence still allowed before release
+static struct rem_code rem_lastcode;	// key held down
+static enum but_type rem_lastbutton;	// its button
+static uint8_t rem_repeats;			// repeat frames since the key went down (saturates)
+
+// learning mailbox, shared with the UI
+static volatile uint8_t rem_learning = 0;	// nonzero while waiting for a key to learn
+static volatile uint8_t rem_haslearned = 0;	// nonzero once rem_learned holds a key
+static struct rem_code rem_learned;			// key caught while learning
+
+#ifdef BENCH
+// decode statistics, written by the Timer1 interrupts
+static uint16_t rem_frames[REM_NPROTOCOLS];	// good frames
+static uint16_t rem_errors[REM_NPROTOCOLS];	// frames given up on
+#endif
+
+void reminit() {
+	if(eeprom_read_byte(&ee_keymapvalid) != REM_KEYMAPVALID) {
+		rem_resetkeys();			// first start: install the default keymap
+	} else {
+		rem_load();
+	}
+	
+	DDRB &= ~(1<<REM_RX);			// make sure IR receiver is input
+	PORTB |= 1<<REM_RX;				// enable pullup
+	
+	TCCR1A = 0;						// Ensure timer is in 'normal' mode
+	TCCR1B |= (1<<ICNC1)|(0<<ICES1)|(1<<CS10);	// Detect falling edge (start of timing), count every cycle
+	TIMSK1 = 1<<ICIE1;				// Enable input compare interrupt for remote receiver
+}
+
+/*
+ * Handles a complete frame from any decoder.
+ * The first frame of a key press queues its button.  Repeat frames sent
+ * while the key is held auto-repeat the volume, tone and direction keys at a
+ * rate that ramps up through rem_ramp.
+ */
+void rem_received(const struct rem_code * code, enum rem_repeat repeat) {
+	uint8_t same = rem_samecode(code, &rem_lastcode);
+	
+#ifdef BENCH
+	if(rem_frames[code->protocol] < 0xffff) rem_frames[code->protocol]++;
+#endif
+	
+	// SIRC repeats every 45 ms; NEC and RC5 leave up to ~100 ms of silence
+	rem_holdwaits = (code->protocol == REM_PROTO_SIRC) ? 0 : 1;
+	
+	if(!rem_held || !same || repeat == REM_NEWPRESS) {	// new key press
+		rem_held = 1;
+		rem_lastcode = *code;
+		rem_repeats = 0;
+		if(rem_learning) {				// hand the key to the UI instead
+			rem_learned = *code;
+			rem_learning = 0;
+			rem_haslearned = 1;
+			rem_lastbutton = BUT_NONE;	// and ignore its repeats
+			return;
+		}
+		rem_lastbutton = rem_lookup(code);
+		if(rem_lastbutton != BUT_NONE) but_push(rem_lastbutton);
+		return;
+	}
+	
+	if(rem_repeats < 0xff) rem_repeats++;
+	
+	if(rem_lastbutton == BUT_VOLINC || rem_lastbutton == BUT_VOLDEC ||
+	   rem_lastbutton == BUT_DIRLEFT || rem_lastbutton == BUT_DIRRIGHT ||
+	   rem_lastbutton == BUT_DIRUP || rem_lastbutton == BUT_DIRDN ||
+	   rem_lastbutton == BUT_BASSINC || rem_lastbutton == BUT_BASSDEC ||
+	   rem_lastbutton == BUT_TREBINC || rem_lastbutton == BUT_TREBDEC) {
+		for(uint8_t r = REM_NRAMP; r > 0; r--) {	// find the stage reached
+			if(rem_repeats >= pgm_read_byte(&rem_ramp[r-1].from)) {
+				if((rem_repeats & pgm_read_byte(&rem_ramp[r-1].mask)) == 0) {
+					but_pushn(rem_lastbutton, pgm_read_byte(&rem_ramp[r-1].steps));
+				}
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Gets the button bound to a received key
+ */
+static enum but_type rem_lookup(const struct rem_code * code) {
+	uint8_t slot = rem_hash(code);
+	
+	while(ram_keyhash[slot].button != BUT_NONE) {
+		if(rem_samecode(&ram_keyhash[slot].code, code)) {
+			return ram_keyhash[slot].button;
+		}
+		slot = (slot + 1) & (REM_NSLOTS - 1);
+	}
+	return BUT_NONE;
+}
+
+/*
+ * Hashes a key to its first slot in ram_keyhash
+ */
+static uint8_t rem_hash(const struct rem_code * code) {
+	uint8_t h = code->command;
+	
+	h = h * 7 + (uint8_t)code->address;
+	h = h * 7 + (uint8_t)(code->address >> 8);
+	h = h * 7 + code->protocol;
+	return h & (REM_NSLOTS - 1);
+}
+
+/*
+ * Compares two keys.  Returns nonzero if they are the same.
+ */
+static uint8_t rem_samecode(const struct rem_code * a, const struct rem_code * b) {
+	return a->protocol == b->protocol &&
+		   a->address == b->address &&
+		   a->command == b->command;
+}
+
+/*
+ * Rebuilds ram_keyhash from the EEPROM key table.
+ * The remote interrupts are held off meanwhile so they never see a
+ * half-built table; remote edges arriving then are lost.
+ */
+static void rem_load() {
+	struct rem_binding binding;
+	uint8_t timsk = TIMSK1;
+	uint8_t slot;
+	
+	TIMSK1 = timsk & ~((1<<ICIE1)|(1<<OCIE1A));
+	
+	for(slot = 0; slot < REM_NSLOTS; slot++) {
+		ram_keyhash[slot].button = BUT_NONE;
+	}
+	for(uint8_t i = 0; i < REM_NBINDINGS; i++) {
+		eeprom_read_block(&binding, &ee_bindings[i], sizeof(binding));
+		if(binding.button == BUT_NONE || binding.button == 0xff) continue;	// unused
+		
+		slot = rem_hash(&binding.code);
+		while(ram_keyhash[slot].button != BUT_NONE) {
+			slot = (slot + 1) & (REM_NSLOTS - 1);
+		}
+		ram_keyhash[slot] = binding;
+	}
+	
+	TIMSK1 = timsk;
+}
+
+/*
+ * Binds a remote key to a button, replacing any earlier binding of that
+ * key.  Binding to BUT_NONE forgets the key.
+ * Returns nonzero on success, zero if the key table is full.
+ */
+uint8_t rem_bind(const struct rem_code * code, uint8_t button) {
+	struct rem_binding binding;
+	uint8_t i;
+	uint8_t found = REM_NBINDINGS;	// entry to write
+	
+	for(i = 0; i < REM_NBINDINGS; i++) {
+		eeprom_read_block(&binding, &ee_bindings[i], sizeof(binding));
+		if(binding.button == BUT_NONE || binding.button == 0xff) {
+			if(found == REM_NBINDINGS) found = i;	// first free entry
+		} else if(rem_samecode(&binding.code, code)) {
+			found = i;
+			break;
+		}
+	}
+	if(found == REM_NBINDINGS) return button == BUT_NONE;	// full, unless forgetting
+	
+	binding.code = *code;
+	binding.button = button;
+	PORTB |= 1<<EE_LED;		// turn on EEPROM access LED
+	eeprom_update_block(&binding, &ee_bindings[found], sizeof(binding));
+	PORTB &= ~(1<<EE_LED);	// turn off EEPROM access LED
+	
+	rem_load();
+	return 1;
+}
+
+/*
+ * Forgets all learned keys and restores the default keymap
+ */
+void rem_resetkeys() {
+	struct rem_binding binding;
+	
+	PORTB |= 1<<EE_LED;		// turn on EEPROM access LED
+	for(uint8_t i = 0; i < REM_NBINDINGS; i++) {
+		if(i < REM_NKEYS) {
+			memcpy_P(&binding, &rem_keymap[i], sizeof(binding));
+		} else {
+			binding.button = BUT_NONE;
+		}
+		eeprom_update_block(&binding, &ee_bindings[i], sizeof(binding));
+	}
+	eeprom_update_byte(&ee_keymapvalid, REM_KEYMAPVALID);
+	PORTB &= ~(1<<EE_LED);	// turn off EEPROM access LED
+	
+	rem_load();
+}
+
+/*
+ * Starts learning: the next new key press is held for rem_getlearned()
+ * instead of being looked up.
+ */
+void rem_learn() {
+	rem_haslearned = 0;
+	rem_learning = 1;
+}
+
+/*
+ * Stops learning without waiting for a key
+ */
+void rem_cancellearn() {
+	rem_learning = 0;
+}
+
+/*
+ * Gets the key caught since rem_learn() was called.
+ * Returns nonzero and fills in *code if there is one.
+ */
+uint8_t rem_getlearned(struct rem_code * code) {
+	if(!rem_haslearned) return 0;
+	*code = rem_learned;	// the interrupt won't touch it until rem_learn()
+	rem_haslearned = 0;
+	return 1;
+}
+
+#ifdef BENCH
+/*
+ * Counts a frame a decoder gave up on
+ */
+void rem_rejected(enum rem_protocol protocol) {
+	if(rem_errors[protocol] < 0xffff) rem_errors[protocol]++;
+}
+
+/*
+ * Gets the number of good frames received in a protocol
+ */
+uint16_t rem_getframes(enum rem_protocol protocol) {
+	uint16_t r;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		r = rem_frames[protocol];
+	}
+	return r;
+}
+
+/*
+ * Gets the number of broken frames received in a protocol
+ */
+uint16_t rem_geterrors(enum rem_protocol protocol) {
+	uint16_t r;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		r = rem_errors[protocol];
+	}
+	return r;
+}
+
+/*
+ * Clears the decode statistics
+ */
+void rem_resetstats() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for(uint8_t i = 0; i < REM_NPROTOCOLS; i++) {
+			rem_frames[i] = rem_errors[i] = 0;
+		}
+	}
+}
+#endif
+
+/*
+ * Passes an edge to every compiled-in decoder
+ */
+static void rem_decode(uint8_t mark, uint16_t length) {
+#ifdef REM_USE_SIRC
+	{
+		BENCH_BEGIN();
+		sirc_edge(mark, length);
+		BENCH_END(BENCH_SIRC);
+	}
+#endif
+#ifdef REM_USE_NEC
+	{
+		BENCH_BEGIN();
+		nec_edge(mark, length);
+		BENCH_END(BENCH_NEC);
+	}
+#endif
+#ifdef REM_USE_RC5
+	{
+		BENCH_BEGIN();
+		rc5_edge(mark, length);
+		BENCH_END(BENCH_RC5);
+	}
+#endif
+}
+
+/*
+ * Tells every compiled-in decoder that the receiver has gone quiet
+ */
+static void rem_idle() {
+#ifdef REM_USE_SIRC
+	sirc_idle();
+#endif
+#ifdef REM_USE_NEC
+	nec_idle();
+#endif
+#ifdef REM_USE_RC5
+	rc5_idle();
+#endif
+}
+
+/*
+ * Called on every IR receiver edge.  Timestamps the edge, then re-arms
+ * input capture for the opposite edge and the silence timeout.
+ * The receiver output is active-low, so a rising edge ends a mark.
+ */
+ISR(TIMER1_CAPT_vect) {
+	BENCH_BEGIN();
+	uint16_t edge = ICR1;
+	uint16_t length = edge - rem_lastedge;
+	
+	rem_lastedge = edge;
+	TCCR1B ^= 1<<ICES1;			// capture the opposite edge next
+	TIFR1 = (1<<ICF1)|(1<<OCF1A);	// clear flag raised by changing edge (and any old timeout)
+	OCR1A = edge + REM_TIMEOUT;	// push back silence timeout
+	TIMSK1 |= 1<<OCIE1A;
+	
+	rem_decode(!(TCCR1B & (1<<ICES1)), length);	// now waiting for a falling edge: a mark ended
+	BENCH_END(BENCH_REMISR);
+}
+
+/*
+ * Called when the remote has been silent for REM_TIMEOUT, and again every
+ * timer period (65.5 ms) after that while rem_holdwaits allows.  Once the
+ * waits run out the key has been lifted, so the next frame is a new press.
+ */
+ISR(TIMER1_COMPA_vect) {
+	rem_idle();					// finish or drop any frame in progress
+	TCCR1B &= ~(1<<ICES1);		// line is idle: wait for a mark to start
+	TIFR1 = 1<<ICF1;			// clear flag raised by changing edge
+	
+	if(rem_holdwaits) {			// OCR1A is left alone, so this fires again
+		rem_holdwaits--;
+		return;
+	}
+	rem_held = 0;
+	TIMSK1 &= ~(1<<OCIE1A);		// nothing to time out until the next edge
+}
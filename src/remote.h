@@ -0,0 +1,112 @@
+/*
+ * remote.h - IR remote control receiver for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * remote.c timestamps every receiver edge with Timer1 input capture and
+ * hands the edge to each protocol decoder that is compiled in.  Decoders
+ * are selected with -DREM_USE_SIRC, -DREM_USE_NEC and -DREM_USE_RC5; code
+ * for the others is not built.  With none selected, SIRC is used.
+ */ 
+
+#ifndef REMOTE_H_
+#define REMOTE_H_
+
+#include <stdint.h>
+
+#if !defined(REM_USE_SIRC) && !defined(REM_USE_NEC) && !defined(REM_USE_RC5)
+#define REM_USE_SIRC
+#endif
+
+enum rem_protocol {
+	REM_PROTO_SIRC,		// Sony SIRC, 12, 15 or 20 bits
+	REM_PROTO_NEC,		// NEC and extended NEC
+	REM_PROTO_RC5,		// Philips RC5 and RC5X
+	REM_NPROTOCOLS
+};
+
+// how a decoder knows whether a frame is a repeat of a held key
+enum rem_repeat {
+	REM_FRAME,		// can't tell: same code while a key is held is a repeat
+	REM_REPEAT,		// the protocol says this is a repeat
+	REM_NEWPRESS	// the protocol says this is a new key press
+};
+
+// a decoded remote key
+struct rem_code {
+	enum rem_protocol protocol;
+	uint16_t address;
+	uint8_t command;
+};
+
+// loads the key table and sets up Timer1 input capture for the IR receiver
+void reminit();
+
+/* Key table.
+   Remote keys are bound to buttons through a table in EEPROM, cached in
+   RAM as a hash table so a key is found in constant time.  The table
+   holds the default Sony keymap until keys are learned. */
+uint8_t rem_bind(const struct rem_code * code, uint8_t button);	// button: an enum but_type
+void rem_resetkeys();
+
+/* Learning.
+   After rem_learn(), the next new key press is not looked up but held
+   until the UI collects it with rem_getlearned(). */
+void rem_learn();
+void rem_cancellearn();
+uint8_t rem_getlearned(struct rem_code * code);
+
+/* Decoder interface.
+   xxx_edge() is called for every receiver edge with the kind of interval
+   that just ended (nonzero for a mark, i.e. IR burst) and its length in
+   microseconds.  xxx_idle() is called when the receiver has been silent
+   long enough for any frame to have ended.  Both run in interrupt context,
+   so they must return quickly and never wait.  A decoder reports each
+   complete frame with rem_received().
+   Decoders touch no hardware and depend only on this header, so they
+   can be driven from a recorded trace of (mark, length) pairs. */
+void rem_received(const struct rem_code * code, enum rem_repeat repeat);
+
+/* Decode statistics (BENCH builds only).
+   A decoder reports a frame it gave up on part way through, after its
+   header or first few bits, with REM_REJECTED().  Good frames are counted
+   by rem_received(). */
+#ifdef BENCH
+void rem_rejected(enum rem_protocol protocol);
+uint16_t rem_getframes(enum rem_protocol protocol);
+uint16_t rem_geterrors(enum rem_protocol protocol);
+void rem_resetstats();
+#define REM_REJECTED(protocol) rem_rejected(protocol)
+#else
+#define REM_REJECTED(protocol) do {} while(0)
+#endif
+
+#ifdef REM_USE_SIRC
+void sirc_edge(uint8_t mark, uint16_t length);
+void sirc_idle();
+#endif
+
+#ifdef REM_USE_NEC
+void nec_edge(uint8_t mark, uint16_t length);
+void nec_idle();
+#endif
+
+#ifdef REM_USE_RC5
+void rc5_edge(uint8_t mark, uint16_t length);
+void rc5_idle();
+#endif
+
+#endif /* REMOTE_H_ */
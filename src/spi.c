@@ -17,15 +17,112 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  *
  * SPI master library
+ *
+ * The display and the pots share the bus.  Whoever holds it is kept in
+ * spi_owner.  Queued transfers are sent by the transfer complete
+ * interrupt, which takes the bus atomically for each one, so a blocking
+ * transaction from the main loop is never cut into; a transfer that finds
+ * the bus taken waits for spi_end() or the tick.  A handshaking device
+ * that is still holding SCK when its byte completes is waited for with
+ * the SCK pin-change interrupt, so the next byte follows within
+ * microseconds of the release rather than on the next tick.
  */ 
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stddef.h>
 #include "spi.h"
 #include "pins.h"
 
-void spiinit(uint8_t bit_order, uint8_t data_mode, uint8_t speed) {
-	DDRB |= (1<<SPI_MOSI)|(1<<SPI_SCK);	// MOSI and SCK are output since this chip is master
-	SPCR = (1<<SPE)|bit_order|(1<<MSTR)|data_mode|speed;
+static const struct spi_device * volatile spi_owner = NULL;	// device holding the bus (NULL: free)
+static const struct spi_device * spi_setup = NULL;	// device SPCR is set up for
+
+/*
+ * Transfer queue.  Filled by the main loop and by interrupts (callbacks,
+ * the display's tick), so submitting is atomic; drained by the SPI
+ * interrupt.  Indices run freely like the button queue's.
+ */
+static struct spi_xfer * volatile spi_queue[SPI_QLEN];
+static volatile uint8_t spi_qhead = 0;
+static volatile uint8_t spi_qtail = 0;
+
+// queue state, shared with the SPI and tick interrupts
+static struct spi_xfer * volatile spi_cur = NULL;	// transfer being sent
+static volatile uint8_t spi_pos;			// next byte of spi_cur
+static volatile uint8_t spi_waitsck = 0;	// nonzero while a device is holding SCK low
+static volatile uint8_t spi_stalled = 0;	// nonzero if the next transfer found the bus taken
+
+// statistics
+static uint8_t spi_maxfill = 0;
+static uint32_t spi_bytes = 0;
+static uint32_t spi_xfers = 0;
+
+static void spi_deselect(const struct spi_device * dev);
+static void spi_next();
+static void spi_sendbyte();
+static void spi_shifted();
+static void spi_continue();
+static void spi_waitrelease();
+static void spi_released();
+
+void spi_devinit(const struct spi_device * dev) {
+	PORTB |= 1<<dev->cs;	// CS is high (disabled) until spi_begin()
+	DDRB |= 1<<dev->cs;		// chip select is output
+}
+
+void spi_setspeed(struct spi_device * dev, uint8_t speed) {
+	uint8_t spr = (speed < 6) ? speed >> 1 : 3;	// SPR bits, with SPI2X doubling the even speeds
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		dev->spcr = (dev->spcr & ~((1<<SPR1)|(1<<SPR0))) | (spr<<SPR0);
+		dev->spsr = (speed < 6 && !(speed & 1)) ? 1<<SPI2X : 0;
+		if(spi_setup == dev) spi_setup = NULL;	// set the bus up again on its next use
+	}
+}
+
+void spi_begin(const struct spi_device * dev) {
+	while(!spi_trybegin(dev)) {
+		if(!(SREG & (1<<SREG_I))) spi_poll();	// the queue has it and no interrupt will come
+	}
+}
+
+uint8_t spi_trybegin(const struct spi_device * dev) {
+	uint8_t taken = 0;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// interrupts also write PORTB and DDRB
+		if(spi_owner == NULL) {
+			spi_owner = dev;
+			taken = 1;
+			DDRB |= (1<<SPI_MOSI)|(1<<SPI_SCK);	// MOSI and SCK are output since this chip is master
+			if(spi_setup != dev) {
+				SPCR = dev->spcr;
+				SPSR = dev->spsr;		// only SPI2X is writable
+				spi_setup = dev;
+			}
+			PORTB &= ~(1<<dev->cs);	// select the device
+		}
+	}
+	return taken;
+}
+
+void spi_end(const struct spi_device * dev) {
+	spi_deselect(dev);
+	if(spi_stalled) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			spi_next();			// the queue wanted the bus meanwhile
+		}
+	}
+}
+
+/*
+ * Deselects the device and frees the bus
+ */
+static void spi_deselect(const struct spi_device * dev) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// the USART interrupt writes POT_CS
+		PORTB |= 1<<dev->cs;
+		spi_owner = NULL;
+	}
 }
 
 char spi_transfer(char c) {
@@ -37,3 +134,155 @@ char spi_transfer(char c) {
 	r = SPDR;						// get received byte
 	return r;
 }
+
+void spi_submit(struct spi_xfer * xfer) {
+	uint8_t fill;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		spi_queue[spi_qhead++ & (SPI_QLEN - 1)] = xfer;
+		fill = spi_qhead - spi_qtail;
+		if(fill > spi_maxfill) spi_maxfill = fill;
+		spi_next();
+	}
+}
+
+/*
+ * Starts the transfer at the head of the queue, unless one is being sent
+ * or the queue is empty.  Interrupts must be disabled.
+ */
+static void spi_next() {
+	struct spi_xfer * xfer;
+	
+	if(spi_cur != NULL || spi_qhead == spi_qtail) return;
+	xfer = spi_queue[spi_qtail & (SPI_QLEN - 1)];
+	spi_stalled = !spi_trybegin(xfer->dev);
+	if(spi_stalled) return;
+	
+	spi_cur = xfer;
+	spi_pos = 0;
+	SPCR |= 1<<SPIE;			// drain from the transfer complete interrupt
+	spi_sendbyte();
+}
+
+/*
+ * Sends the next byte of the current transfer.  Interrupts must be
+ * disabled.
+ */
+static void spi_sendbyte() {
+	DDRB |= 1<<SPI_SCK;			// take SCK back from a handshaking device
+	SPDR = spi_cur->buf[spi_pos++];
+}
+
+/*
+ * Called when a byte has been shifted out.  A handshaking device holds
+ * SCK low while it digests the byte, so the next one goes out as soon as
+ * it lets go, here or from the tick.
+ * Interrupts must be disabled.
+ */
+static void spi_shifted() {
+	(void)SPDR;
+	spi_bytes++;
+	if(spi_cur->dev->flags & SPI_HANDSHAKE) {
+		DDRB &= ~(1<<SPI_SCK);	// SCK is now input w/pullup
+		if(!(PINB & (1<<SPI_SCK))) {
+			spi_waitrelease();
+			return;
+		}
+	}
+	spi_continue();
+}
+
+/*
+ * Waits for a handshaking device to let go of SCK.  The pin-change
+ * interrupt is armed before SCK is read again, so a release in between
+ * is caught either way.  Interrupts must be disabled.
+ */
+static void spi_waitrelease() {
+	spi_waitsck = 1;
+	PCMSK0 |= 1<<PCI0_SCK;
+	PCIFR = 1<<PCIF0;			// forget changes from before the wait
+	PCICR |= 1<<PCIE0;
+	if(PINB & (1<<SPI_SCK)) spi_released();
+}
+
+/*
+ * Disarms the SCK wait and sends on.  Interrupts must be disabled.
+ */
+static void spi_released() {
+	PCICR &= ~(1<<PCIE0);		// SCK is driven again from here on
+	PCMSK0 &= ~(1<<PCI0_SCK);
+	spi_waitsck = 0;
+	spi_continue();
+}
+
+/*
+ * Sends the next byte, or finishes the transfer and starts the next one.
+ * Interrupts must be disabled.
+ */
+static void spi_continue() {
+	struct spi_xfer * xfer = spi_cur;
+	
+	if(spi_pos < xfer->len) {
+		spi_sendbyte();
+		return;
+	}
+	SPCR &= ~(1<<SPIE);			// leave the bus to blocking users
+	spi_deselect(xfer->dev);
+	spi_cur = NULL;
+	spi_qtail++;
+	spi_xfers++;
+	if(xfer->done != NULL) xfer->done(xfer);
+	spi_next();
+}
+
+void spi_tick() {
+	if(spi_waitsck && (PINB & (1<<SPI_SCK))) spi_released();	// for spi_poll(), with interrupts off
+	if(spi_stalled) spi_next();
+}
+
+void spi_poll() {
+	if((SPCR & (1<<SPIE)) && (SPSR & (1<<SPIF))) spi_shifted();
+	spi_tick();
+}
+
+ISR(SPI_STC_vect) {
+	spi_shifted();
+}
+
+ISR(PCINT0_vect) {
+	if(spi_waitsck && (PINB & (1<<SPI_SCK))) spi_released();
+}
+
+uint8_t spi_getfill() {
+	return spi_qhead - spi_qtail;
+}
+
+uint8_t spi_getmaxfill() {
+	return spi_maxfill;
+}
+
+uint32_t spi_getbytes() {
+	uint32_t bytes;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		bytes = spi_bytes;
+	}
+	return bytes;
+}
+
+uint32_t spi_getxfers() {
+	uint32_t xfers;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		xfers = spi_xfers;
+	}
+	return xfers;
+}
+
+void spi_resetstats() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		spi_maxfill = 0;
+		spi_bytes = 0;
+		spi_xfers = 0;
+	}
+}
@@ -35,13 +35,91 @@
 #define SPI_CKDIV64 ((1<<SPR1)|(0<<SPR0))
 #define SPI_CKDIV128 ((1<<SPR1)|(1<<SPR0))
 
-/* Shifts out data c, returning any data shifted in.
-   Leaves SPI_SCK input, MOSI output, MISO untouched */
+/* Speeds for spi_setspeed(): speed n divides the CPU clock by 2 << n,
+   so 0 is F_CPU/2 (using SPI2X) and SPI_NSPEEDS - 1 is F_CPU/128. */
+#define SPI_NSPEEDS 7
+#define SPI_SPEEDUNKNOWN 0xff	// no speed chosen yet
+#define SPI_DIVIDER(speed) (2 << (speed))
+
+#define SPI_QLEN 4			// transfer queue length, must be a power of two
+
+// spi_device flags
+#define SPI_HANDSHAKE 0x01	// device holds SCK low after each byte until it has taken it
+
+/* A device on the bus: its chip select pin on PORTB, the SPCR and SPSR
+   (SPI2X) settings it needs and any flags.  Declare one with SPI_DEVICE(). */
+struct spi_device {
+	uint8_t cs;
+	uint8_t spcr;
+	uint8_t spsr;
+	uint8_t flags;
+};
+
+/* describes a device.  bit_order can be SPI_MSBFIRST or SPI_LSBFIRST,
+   data_mode SPI_MODE0 to SPI_MODE3 and speed one of the SPI_CKDIVs;
+   spi_setspeed() can change the speed later. */
+#define SPI_DEVICE(cs, bit_order, data_mode, speed, flags) \
+	{(cs), (1<<SPE)|(1<<MSTR)|(bit_order)|(data_mode)|(speed), 0, (flags)}
+
+/* A queued transfer: len bytes from buf to dev, in one transaction.
+   done is called from the SPI interrupt once the last byte has gone
+   (NULL for no callback); it may submit the transfer again. */
+struct spi_xfer;
+typedef void (*spi_done_t)(struct spi_xfer * xfer);
+struct spi_xfer {
+	const struct spi_device * dev;
+	const uint8_t * buf;
+	uint8_t len;
+	spi_done_t done;
+};
+
+// makes a device's chip select an output and deselects the device
+void spi_devinit(const struct spi_device * dev);
+
+/* sets a device's SCK divider to one of the speeds above (0 to
+   SPI_NSPEEDS - 1).  Takes effect from the device's next transaction. */
+void spi_setspeed(struct spi_device * dev, uint8_t speed);
+
+/* Transactions.
+   spi_begin() waits for the bus to be free, takes it, sets it up for dev
+   (SPCR and SPSR are only rewritten when the device differs from the last
+   one) and selects dev.  spi_end() deselects it and frees the bus for the
+   queue.
+   spi_trybegin() is the same as spi_begin() but returns 0 at once if the
+   bus is taken. */
+void spi_begin(const struct spi_device * dev);
+uint8_t spi_trybegin(const struct spi_device * dev);
+void spi_end(const struct spi_device * dev);
+
+/* Shifts out data c, returning any data shifted in.  Call within a
+   transaction.  Leaves SPI_SCK output, MOSI output, MISO untouched */
 char spi_transfer(char c);
 
-/* Initializes SPI bus.  Leaves SPI_SCK input, MOSI output, MISO untouched. 
-   bit_order can be SPI_MSBFIRST or SPI_LSBFIRST.  data_mode can be SPI_MODE0,
-   SPI_MODE1, SPI_MODE2, or SPI_MODE3.  */
-void spiinit(uint8_t bit_order, uint8_t data_mode, uint8_t speed);
+/* Queues a transfer and returns at once; the SPI interrupt sends it.
+   The transfer and its buffer must be left alone until done is called.
+   len must not be 0.  The queue holds SPI_QLEN transfers, so no more than
+   that may be outstanding at once; each user keeps at most one. */
+void spi_submit(struct spi_xfer * xfer);
+
+// retries a stalled queue, and finishes SCK handshakes when interrupts are off; called from the tick interrupt
+void spi_tick();
+
+// drives the queue while interrupts are disabled, as at startup
+void spi_poll();
+
+// gets the number of transfers queued or being sent
+uint8_t spi_getfill();
+
+// gets the most transfers that have been queued at once
+uint8_t spi_getmaxfill();
+
+// gets the number of bytes the queue has sent
+uint32_t spi_getbytes();
+
+// gets the number of transfers the queue has finished
+uint32_t spi_getxfers();
+
+// clears the queue statistics
+void spi_resetstats();
 
 #endif /* SPI_H_ */
@@ -0,0 +1,92 @@
+/*
+ * tick.c - Periodic timer tick for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */ 
+
+#if F_CPU != 1000000UL
+#error "F_CPU must be 1000000 Hz. Other CPU frequencies are not yet supported."
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stdint.h>
+#include "tick.h"
+#include "buttons.h"
+#include "vfd.h"
+#include "spi.h"
+#include "preamp.h"
+#include "bench.h"
+
+static volatile uint16_t tick_count = 0;
+static uint8_t tick_busy = 0;			// nonzero while a tick's slow work runs
+
+void tickinit() {
+	TCCR0A = 1<<WGM01;				// CTC mode, TOP = OCR0A
+	TCCR0B = 1<<CS01;				// F_CPU/8 = 125 kHz
+	OCR0A = (F_CPU / 8 / TICK_HZ) - 1;	// 125 counts per tick
+	TIMSK0 = 1<<OCIE0A;				// interrupt at TOP
+}
+
+uint16_t tick_now() {
+	uint16_t t;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		t = tick_count;
+	}
+	return t;
+}
+
+/*
+ * Called every tick.  Only the sampling and the bus handshake run with
+ * interrupts disabled; the display and pot work after it can take longer
+ * than an IR pulse, so it runs with them enabled.  A tick arriving while
+ * that work is still running only samples.
+ */
+ISR(TIMER0_COMPA_vect) {
+	enum but_type next;
+	
+	BENCH_BEGIN();
+	tick_count++;
+	but_tick();
+	next = but_peek();
+	spi_tick();
+	BENCH_END(BENCH_TICKISR);
+	
+	if(tick_busy) return;
+	tick_busy = 1;
+	/* From here a nested tick can run but_tick() and spi_tick() while this
+	   one is part way through pre_tick() or vfd_tick().  That is safe: the
+	   nested tick's work runs with interrupts disabled, and this work only
+	   changes the SPI queue indices, spi_stalled and spi_waitsck inside
+	   the ATOMIC_BLOCKs of spi_submit(), spi_trybegin() and spi_end(), so a
+	   nested spi_tick() always finds them consistent.  At worst it starts
+	   a stalled transfer just before spi_end() would have, and spi_next()
+	   then does nothing.  The button queue is only fed by but_tick() and
+	   the IR interrupt, which never run at the same time. */
+	sei();
+	{
+		BENCH_BEGIN();
+		if(next != BUT_NONE && !(next & (BUT_HELD|BUT_RELEASED))) {
+			vfd_wake();			// brighten up before the UI gets round to the input
+		}
+		pre_tick();
+		vfd_tick();
+		cli();
+		BENCH_END(BENCH_TICKWORK);	// wall time, so it includes every interrupt that nested in it
+	}
+	tick_busy = 0;
+}
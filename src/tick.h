@@ -0,0 +1,37 @@
+/*
+ * tick.h - Periodic timer tick for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Timer0 interrupts once per millisecond to sample the local controls and
+ * keep time for anything that must not busy-wait.
+ */ 
+
+#ifndef TICK_H_
+#define TICK_H_
+
+#include <stdint.h>
+
+#define TICK_HZ 1000	// tick interrupts per second
+
+// sets up Timer0 to interrupt every tick
+void tickinit();
+
+/* gets the number of ticks since startup.  Wraps every 65.5 seconds,
+   so compare times by subtraction. */
+uint16_t tick_now();
+
+#endif /* TICK_H_ */
@@ -25,32 +25,93 @@
 #include <util/delay.h>
 #include <avr/pgmspace.h>
 #include "vfd.h"
+#include "spi.h"
+#include "glyph.h"
+#include "fmt.h"
+#include "layer.h"
 #include "inputnames.h"
 #include "preamp.h"
 #include "pins.h"
 #include "buttons.h"
 #include "lang.h"
 #include "ui.h"
+#include "remote.h"
+#include "tick.h"
+#include "bench.h"
+#include "latency.h"
 
 #define UI_HOLD_TIME 3000	// time to hold volume value on display, in milliseconds
+#define UI_MSG_TIME 1500	// time to show a result message, in milliseconds
+#define UI_NACTIONS 16		// entries in ui_actions
 
-static volatile uint16_t idle_timeout = 0;	// centisecond idle timeout counter
+#if defined(BENCH) || defined(LATENCY)
+#define UI_DIAG				// build the diagnostics menu
+#define UI_ROOTCHOICES 8	// last root menu entry is diagnostics
+#else
+#define UI_ROOTCHOICES 7
+#endif
+
+// diagnostics pages: benchmark slots, IR decode counts, display counters,
+// then latency statistics
+#define UI_DECODEPAGES (2 * REM_NPROTOCOLS)	// good and bad frames per protocol
+#define UI_COUNTERPAGES 7					// VFD bytes saved, frames skipped, glyph hits and misses, SPI queue
+#ifdef BENCH
+#define UI_BENCHPAGES (BENCH_NSLOTS + UI_DECODEPAGES + UI_COUNTERPAGES)
+#else
+#define UI_BENCHPAGES 0
+#endif
+#ifdef LATENCY
+#define UI_LATFIELDS (4 + LAT_NBINS)	// min, mean, max, count, histogram
+#define UI_DIAGPAGES (UI_BENCHPAGES + LAT_NSTAGES * UI_LATFIELDS)
+#else
+#define UI_DIAGPAGES UI_BENCHPAGES
+#endif
+
+// buttons a remote key can be bound to, in LANG_KEYS_ACTIONS order
+static const uint8_t PROGMEM ui_actions[UI_NACTIONS] = {
+	BUT_ENTER, BUT_BACK, BUT_VOLINC, BUT_VOLDEC, BUT_SELUPL, BUT_SELDNR,
+	BUT_DIRUP, BUT_DIRDN, BUT_DIRLEFT, BUT_DIRRIGHT, BUT_MUTE,
+	BUT_BASSINC, BUT_BASSDEC, BUT_TREBINC, BUT_TREBDEC, BUT_NONE
+};
+
+static uint16_t ui_inputtime;			// tick of the last press
+static uint8_t ui_idlepending = 0;		// nonzero until the idle tasks have run after a press
 
 static void ui_idle();
 static void ui_showinput();
+static void ui_drawinput();
+static enum but_type ui_popbatch(uint8_t * steps);
 static void ui_buttonISR();
 static void ui_rootmenu();
 static void ui_tonemenu();
 static void ui_namemenu();
 static void ui_nameedit(uint8_t);
 static void ui_brightnessmenu();
+static void ui_keysmenu();
+static void ui_learnkey(enum but_type button);
+static void ui_pause(uint16_t ms);
+static uint8_t ui_pressed();
+static void ui_waitpress();
+static void ui_spical();
+#ifdef UI_DIAG
+static void ui_diagmenu();
+static void ui_showdiag(uint8_t page);
+#endif
 
+static void ui_showvolume();
+static void ui_drawvolume();
+static void ui_showtone();
+static void ui_drawtone();
+static void ui_showmute();
+static void ui_drawmute();
+static void ui_showramp();
 static void ui_showspeaker();
 static void ui_showactivebrightness();
 static void ui_showidlebrightness();
 static void ui_showtoneactive();
 static void ui_showtonebass();
 static void ui_showtonetreb();
+static void ui_showsetting(PGM_P label_P, int8_t value, uint8_t flags);
 
 /*
  * Note that this does NOT set global interrupts; that is done
@@ -62,30 +123,24 @@ void uiinit() {
 	//set_sleep_mode(SLEEP_MODE_IDLE);// set IDLE as the sleep mode
 	
 	vfd_idlebrightness();// calm VFD down
-	ui_showinput();		// go to default screen
+	layer_show(LAYER_BASE, ui_drawinput, 0);	// go to default screen
 }
 
 /*
  * displays menu/status
  */
 void uiloop() {
-	while(!but_peek());		// wait for a button press
-	ui_buttonISR();					// go do menu stuff
-	
-	//cli();							// block interrupts from messing with idle_timeout access
-	if(idle_timeout > 0) {			// block EEPROM writes from BUT_NONE
-		while(idle_timeout > 0) {		// delay ui_idle until timeout expires to avoid excessive EEPROM writes
-			if(but_peek()) {
-				ui_buttonISR();
-			}
-			
-			idle_timeout--;
-	//		sei();						// make sure interrupts work while waiting
-			_delay_ms(1);
-	//		cli();
-		}
-		ui_idle();						// run idle tasks (show input, save settings to EEPROM)
+	if(but_peek()) {
+		ui_buttonISR();					// go do menu stuff
 	}
+	
+	// delay ui_idle until presses stop for a while to avoid excessive EEPROM writes
+	if(ui_idlepending && (uint16_t)(tick_now() - ui_inputtime) >= UI_HOLD_TIME) {
+		ui_idlepending = 0;
+		ui_idle();						// run idle tasks (save settings to EEPROM, dim)
+	}
+	
+	layer_update();					// redraw the display if anything changed or expired
 	//sleep_enable();
 	//sei();
 	//sleep_cpu();
@@ -93,20 +148,44 @@ void uiloop() {
 }
 
 /*
- * shows the currently selected input
+ * Accepts the oldest outstanding button press.
+ * Volume knob turns are taken whole, with the number of merged (and
+ * accelerated) steps stored in *steps, so they can be applied as one
+ * update.  Anything else is taken one step at a time.
+ */
+static enum but_type ui_popbatch(uint8_t * steps) {
+	enum but_type pressed = but_peek();
+	
+	if(pressed == BUT_VOLINC || pressed == BUT_VOLDEC) {
+		return but_popn(steps);
+	}
+	*steps = 1;
+	return but_pop();
+}
+
+/*
+ * shows the currently selected input, dropping any overlay
  */
 static void ui_showinput() {
-	char msg[17];
+	layer_hide(LAYER_VOLUME);
+	layer_hide(LAYER_TONE);
+	layer_invalidate();		// the display may have been used by a menu
+}
+
+/*
+ * draws the currently selected input (the base layer)
+ */
+static void ui_drawinput() {
+	char msg[17];			// names are stored in 16 characters, so they always fit
 	name_get(msg, pre_getcurrentinput());
-	center_display(msg);
+	vfd_drawcentered(msg);
 }
 
 /*
  * Idle tasks
- * (show input and then save settings)
+ * (save settings; any overlay has expired by now)
  */
 static void ui_idle() {
-	ui_showinput();			// show current input while idle
 	pre_save();				// save volume, tone, input settings
 	vfd_idlebrightness();	// set display to idle brightness
 }
@@ -133,6 +212,20 @@ static void ui_rootmenu() {
 		case 3:
 			update_display_P(LANG_BRIGHTNESS);
 			break;
+		case 4:
+			update_display_P(LANG_KEYS);	// remote key learning
+			break;
+		case 5:
+			update_display_P(LANG_SPICAL);	// SPI clock calibration
+			break;
+		case 6:
+			ui_showramp();
+			break;
+#ifdef UI_DIAG
+		case 7:
+			update_display_P(LANG_DIAG);
+			break;
+#endif
 		}
 		
 		while(!but_peek());
@@ -142,7 +235,7 @@ static void ui_rootmenu() {
 		case BUT_SELUPL:
 		case BUT_DIRUP:
 			if(choice == 0) {
-				choice = 3;
+				choice = UI_ROOTCHOICES - 1;
 			} else {
 				choice--;
 			}
@@ -150,7 +243,7 @@ static void ui_rootmenu() {
 		case BUT_SELDNR:
 		case BUT_DIRDN:
 			choice++;
-			if(choice > 3) choice = 0;
+			if(choice >= UI_ROOTCHOICES) choice = 0;
 			break;
 		case BUT_ENTER:
 			if(choice == 0) {
@@ -159,18 +252,31 @@ static void ui_rootmenu() {
 				ui_namemenu();
 			} else if(choice == 3) {
 				ui_brightnessmenu();
+			} else if(choice == 4) {
+				ui_keysmenu();
+			} else if(choice == 5) {
+				ui_spical();
 			}
+#ifdef UI_DIAG
+			else if(choice == 7) {
+				ui_diagmenu();
+			}
+#endif
 			break;
 		case BUT_VOLINC:
 		case BUT_DIRRIGHT:
 			if(choice == 1) {
 				pre_increasespkbehavior();
+			} else if(choice == 6) {
+				pre_increaseramp();
 			}
 			break;
 		case BUT_VOLDEC:
 		case BUT_DIRLEFT:
 			if(choice == 1) {
 				pre_decreasespkbehavior();
+			} else if(choice == 6) {
+				pre_decreaseramp();
 			}
 		default:	// catch other enum values
 			break;
@@ -185,6 +291,7 @@ static void ui_rootmenu() {
  */
 static void ui_tonemenu() {
 	uint8_t choice = 0;
+	uint8_t steps;
 	enum but_type pressed;
 
 	do {
@@ -201,7 +308,7 @@ static void ui_tonemenu() {
 		}
 		
 		while(!but_peek());
-		pressed = but_pop();
+		pressed = ui_popbatch(&steps);
 		
 		switch(pressed) {
 		case BUT_SELUPL:
@@ -222,9 +329,9 @@ static void ui_tonemenu() {
 			if(choice == 0) {
 				pre_increasetonebehavior();
 			} else if(choice == 1) {
-				pre_increasebass();
+				pre_changebass(steps);
 			} else if(choice == 2) {
-				pre_increasetreb();
+				pre_changetreb(steps);
 			}
 			break;
 		case BUT_VOLDEC:
@@ -232,9 +339,9 @@ static void ui_tonemenu() {
 			if(choice == 0) {
 				pre_decreasetonebehavior();
 			} else if(choice == 1) {
-				pre_decreasebass();
+				pre_changebass(-steps);
 			} else if(choice == 2) {
-				pre_decreasetreb();
+				pre_changetreb(-steps);
 			}
 			break;
 		default:	// catch other enum values
@@ -250,14 +357,14 @@ static void ui_tonemenu() {
 static void ui_namemenu() {
 	uint8_t choice = 0;
 	enum but_type pressed;
-	char msg[17];
+	char msg[VFD_MARQUEELEN + 1];		// prefix and name, scrolled if too long
 	char name[17];
 	
 	do {
 		
 		name_get(name, choice);
 		name_getprefix(msg, choice);
-		strlcat(msg, name, 17);
+		strlcat(msg, name, sizeof(msg));
 		update_display(msg);
 		
 		while(!but_peek());
@@ -300,6 +407,7 @@ static void ui_nameedit(uint8_t n_input) {
 	char name_cursor[17];				// the name with blinking cursor overlay
 	char msg[17];						// what is shown on the VFD
 	enum but_type pressed;              // button state storage
+	uint8_t steps;						// merged steps of a volume knob turn
 	uint8_t cursortime = 0;				// used to time cursor blinks
 	
 	name_get(name, n_input);			// load the old input name
@@ -337,7 +445,7 @@ static void ui_nameedit(uint8_t n_input) {
 			update_display(msg);
 		} while(!but_peek());
 		
-		pressed = but_pop();	// debounce
+		pressed = ui_popbatch(&steps);
 		
 		switch(pressed) {
 		case BUT_SELUPL:
@@ -359,26 +467,30 @@ static void ui_nameedit(uint8_t n_input) {
 			break;
 		case BUT_VOLINC:		// volume knob right
 		case BUT_DIRDN:			// button down
-			name[edit_pos]++;	// go down the alphabet A-->B
+			while(steps--) {
+				name[edit_pos]++;	// go down the alphabet A-->B
 
-			if(name[edit_pos] == '!') name[edit_pos] = 'a';
-			else if(name[edit_pos] >= '{') name[edit_pos] = 'A';
-			else if(name[edit_pos] == '[') name[edit_pos] = '0';
-			else if(name[edit_pos] == ':') name[edit_pos] = '\'';
-			else if(name[edit_pos] == '*') name[edit_pos] = ' ';
+				if(name[edit_pos] == '!') name[edit_pos] = 'a';
+				else if(name[edit_pos] >= '{') name[edit_pos] = 'A';
+				else if(name[edit_pos] == '[') name[edit_pos] = '0';
+				else if(name[edit_pos] == ':') name[edit_pos] = '\'';
+				else if(name[edit_pos] == '*') name[edit_pos] = ' ';
+			}
 
 			name_cursor[edit_pos] = name[edit_pos];
 
 			break;
 		case BUT_VOLDEC:		// volume knob left
 		case BUT_DIRUP:			// button up
-			name[edit_pos]--;	// go up the alphabet B-->A
-			
-			if(name[edit_pos] < ' ') name[edit_pos] = ')';
-			else if(name[edit_pos] == '&') name[edit_pos] = '9';
-			else if(name[edit_pos] == '/') name[edit_pos] = 'Z';
-			else if(name[edit_pos] == '`') name[edit_pos] = ' ';
-			else if(name[edit_pos] == '@') name[edit_pos] = 'z';
+			while(steps--) {
+				name[edit_pos]--;	// go up the alphabet B-->A
+				
+				if(name[edit_pos] < ' ') name[edit_pos] = ')';
+				else if(name[edit_pos] == '&') name[edit_pos] = '9';
+				else if(name[edit_pos] == '/') name[edit_pos] = 'Z';
+				else if(name[edit_pos] == '`') name[edit_pos] = ' ';
+				else if(name[edit_pos] == '@') name[edit_pos] = 'z';
+			}
 			
 			name_cursor[edit_pos] = name[edit_pos];
 			
@@ -455,6 +567,287 @@ static void ui_brightnessmenu() {
 	
 }
 
+/*
+ * Remote key menu
+ * Lists the actions a remote key can be learned for, then resetting
+ * the keys to the default keymap.
+ */
+static void ui_keysmenu() {
+	uint8_t choice = 0;
+	enum but_type pressed;
+	
+	do {
+		if(choice < UI_NACTIONS) {
+			fmt_clear(fmt_label_P(fmt_label_P(0, LANG_KEYS_LEARN),
+				(PGM_P)pgm_read_word(&LANG_KEYS_ACTIONS[choice])));
+			vfd_commit();
+		} else {
+			update_display_P(LANG_KEYS_RESET);
+		}
+		
+		while(!but_peek());
+		pressed = but_pop();
+		
+		switch(pressed) {
+		case BUT_SELUPL:
+		case BUT_DIRUP:
+			if(choice == 0) {
+				choice = UI_NACTIONS;
+			} else {
+				choice--;
+			}
+			break;
+		case BUT_SELDNR:
+		case BUT_DIRDN:
+			choice++;
+			if(choice > UI_NACTIONS) choice = 0;
+			break;
+		case BUT_ENTER:
+			if(choice < UI_NACTIONS) {
+				ui_learnkey(pgm_read_byte(&ui_actions[choice]));
+			} else {
+				rem_resetkeys();
+				update_display_P(LANG_KEYS_DONE);
+				ui_pause(UI_MSG_TIME);
+			}
+			break;
+		default:	// catch other enum values
+			break;
+		}
+		
+	} while(pressed != (BUT_BACK));
+}
+
+/*
+ * Waits for a remote key and binds it to button.
+ * Back cancels; other buttons are ignored.
+ */
+static void ui_learnkey(enum but_type button) {
+	struct rem_code code;
+	
+	update_display_P(LANG_KEYS_WAIT);
+	rem_learn();
+	while(!rem_getlearned(&code)) {
+		if(ui_pressed() && but_pop() == BUT_BACK) {		// cancelled
+			rem_cancellearn();
+			return;
+		}
+	}
+	
+	if(rem_bind(&code, button)) {
+		update_display_P(LANG_KEYS_DONE);
+	} else {
+		update_display_P(LANG_KEYS_FULL);
+	}
+	ui_pause(UI_MSG_TIME);
+}
+
+/*
+ * Calibrates the SPI clocks and shows the speeds chosen: the display's
+ * divider and SCK release turnaround, then the pots' divider (or that
+ * they can't be tested).  Each stays up until a button is pressed.
+ */
+static void ui_spical() {
+	uint16_t turnaround;
+	uint8_t pos;
+	uint8_t speed;
+	
+	turnaround = vfd_calibrate();	// clears the display
+	
+	pos = fmt_uint(fmt_label_P(0, LANG_SPICAL_VFD), SPI_DIVIDER(vfd_getspispeed()), 0);
+	vfd_setcell(pos++, ' ');
+	fmt_clear(fmt_label_P(fmt_uint(pos, turnaround, 0), LANG_SPICAL_US));
+	vfd_commit();
+	ui_waitpress();
+	
+	speed = pre_calibrate();
+	if(speed == SPI_SPEEDUNKNOWN) {
+		center_display_P(LANG_SPICAL_NOPOTS);	// no readback
+	} else {
+		fmt_clear(fmt_uint(fmt_label_P(0, LANG_SPICAL_POTS), SPI_DIVIDER(speed), 0));
+		vfd_commit();
+	}
+	ui_waitpress();
+}
+
+/*
+ * Waits up to ms milliseconds, or until a button is pressed.  The press
+ * only cuts the wait short; it is not passed on.
+ */
+static void ui_pause(uint16_t ms) {
+	uint16_t start = tick_now();
+	
+	while((uint16_t)(tick_now() - start) < ms) {
+		if(ui_pressed()) {
+			but_pop();
+			return;
+		}
+	}
+}
+
+/*
+ * Waits for a button to be pressed and consumes the press
+ */
+static void ui_waitpress() {
+	while(!ui_pressed());
+	but_pop();
+}
+
+/*
+ * Drops hold and release events from the head of the queue, such as the
+ * release of the press that led here.  Returns nonzero if a new press is
+ * waiting.
+ */
+static uint8_t ui_pressed() {
+	enum but_type next;
+	uint8_t steps;
+	
+	while((next = but_peek()) != BUT_NONE) {
+		if(!(next & (BUT_HELD|BUT_RELEASED))) return 1;
+		but_popn(&steps);
+	}
+	return 0;
+}
+
+#ifdef UI_DIAG
+/*
+ * Diagnostics menu
+ * Pages through the worst-case cycle count of each benchmark slot, the
+ * good and broken frames of each IR protocol, the display's bytes saved
+ * and glyph cache counters, and the latency statistics of each stage.  Enter clears everything.
+ */
+static void ui_diagmenu() {
+	uint8_t choice = 0;
+	enum but_type pressed;
+	
+	do {
+		ui_showdiag(choice);
+		
+		while(!but_peek());
+		pressed = but_pop();
+		
+		switch(pressed) {
+		case BUT_SELUPL:
+		case BUT_DIRUP:
+			if(choice == 0) {
+				choice = UI_DIAGPAGES - 1;
+			} else {
+				choice--;
+			}
+			break;
+		case BUT_SELDNR:
+		case BUT_DIRDN:
+			choice++;
+			if(choice >= UI_DIAGPAGES) choice = 0;
+			break;
+		case BUT_ENTER:
+#ifdef BENCH
+			bench_reset();
+			rem_resetstats();
+			spi_resetstats();
+#endif
+#ifdef LATENCY
+			lat_reset();
+#endif
+			break;
+		default:	// catch other enum values
+			break;
+		}
+		
+	} while(pressed != (BUT_BACK));
+}
+
+/*
+ * shows one page of the diagnostics menu
+ */
+static void ui_showdiag(uint8_t page) {
+	char msg[VFD_MARQUEELEN + 1];		// long readings scroll
+	PGM_P label_P;
+#ifdef LATENCY
+	struct lat_stats stats;
+	uint8_t field;
+#endif
+	
+#ifdef BENCH
+	if(page < BENCH_NSLOTS) {
+		snprintf_P(msg, sizeof(msg), LANG_DIAG_CYCLES,
+			(PGM_P)pgm_read_word(&LANG_BENCH_SLOTS[page]), bench_getmax(page));
+		update_display(msg);
+		return;
+	}
+	page -= BENCH_NSLOTS;
+	if(page < UI_DECODEPAGES) {
+		label_P = (PGM_P)pgm_read_word(&LANG_REM_PROTOCOLS[page / 2]);
+		if(page & 1) {
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_ERRORS, label_P, rem_geterrors(page / 2));
+		} else {
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_FRAMES, label_P, rem_getframes(page / 2));
+		}
+		update_display(msg);
+		return;
+	}
+	page -= UI_DECODEPAGES;
+	if(page < UI_COUNTERPAGES) {
+		switch(page) {
+		case 0:
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_VFDSAVED, vfd_getsaved());
+			break;
+		case 1:
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_VFDSKIPPED, vfd_getskipped());
+			break;
+		case 2:
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_GLYPHHITS, glyph_gethits());
+			break;
+		case 3:
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_GLYPHMISSES, glyph_getmisses());
+			break;
+		case 4:
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_SPIFILL, spi_getfill(), spi_getmaxfill());
+			break;
+		case 5:
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_SPIXFERS, spi_getxfers());
+			break;
+		default:
+			snprintf_P(msg, sizeof(msg), LANG_DIAG_SPIBYTES, spi_getbytes());
+			break;
+		}
+		update_display(msg);
+		return;
+	}
+	page -= UI_COUNTERPAGES;
+#endif
+#ifdef LATENCY
+	field = page % UI_LATFIELDS;
+	label_P = (PGM_P)pgm_read_word(&LANG_LAT_STAGES[page / UI_LATFIELDS]);
+	lat_getstats(page / UI_LATFIELDS, &stats);
+	
+	switch(field) {
+	case 0:
+		snprintf_P(msg, sizeof(msg), LANG_LAT_MIN, label_P, stats.min);
+		break;
+	case 1:
+		snprintf_P(msg, sizeof(msg), LANG_LAT_MEAN, label_P, stats.mean);
+		break;
+	case 2:
+		snprintf_P(msg, sizeof(msg), LANG_LAT_MAX, label_P, stats.max);
+		break;
+	case 3:
+		snprintf_P(msg, sizeof(msg), LANG_LAT_COUNT, label_P, stats.count);
+		break;
+	default:		// histogram bins
+		field -= 4;
+		if(field < LAT_NBINS - 1) {
+			snprintf_P(msg, sizeof(msg), LANG_LAT_BELOW, label_P, LAT_BIN0 << field, stats.hist[field]);
+		} else {
+			snprintf_P(msg, sizeof(msg), LANG_LAT_ABOVE, label_P, LAT_BIN0 << (field - 1), stats.hist[field]);
+		}
+		break;
+	}
+	update_display(msg);
+#endif
+}
+#endif
+
 /*
  * shows the current tone control behavior setting
  */
@@ -483,20 +876,95 @@ static void ui_showtoneactive() {
  * shows the current bass setting
  */
 static void ui_showtonebass() {
-	char msg[17];
-	
-	snprintf_P(msg, 17, LANG_TC_BASS, pre_getbass());
-	update_display(msg);
+	ui_showsetting(LANG_TC_BASS, pre_getbass(), FMT_SIGN);
 }
 
 /*
  * shows the current treble setting
  */
 static void ui_showtonetreb() {
-	char msg[17];
+	ui_showsetting(LANG_TC_TREBLE, pre_gettreb(), FMT_SIGN);
+}
+
+/*
+ * shows a setting as its label followed by its value
+ * BENCH builds also format it with snprintf_P, as it used to be, so the
+ * two can be compared.
+ */
+static void ui_showsetting(PGM_P label_P, int8_t value, uint8_t flags) {
+#ifdef BENCH
+	{
+		char msg[17];
+		BENCH_BEGIN();
+		snprintf_P(msg, sizeof(msg), (flags & FMT_SIGN) ? LANG_BENCH_SIGNED : LANG_BENCH_UNSIGNED,
+			label_P, value);
+		BENCH_END(BENCH_PRINTF);
+	}
+#endif
+	BENCH_BEGIN();
+	fmt_clear(fmt_int(fmt_label_P(0, label_P), value, flags));
+	BENCH_END(BENCH_FMT);
+	vfd_commit();
+}
+
+/*
+ * shows the volume over the input name for a while
+ */
+static void ui_showvolume() {
+	layer_hide(LAYER_TONE);		// it would cover the volume
+	layer_show(LAYER_VOLUME, ui_drawvolume, UI_HOLD_TIME);
+}
+
+/*
+ * draws the volume as a number and a bar graph (the volume layer)
+ */
+static void ui_drawvolume() {
+	uint8_t vol = pre_getvol();
 	
-	snprintf_P(msg, 17, LANG_TC_TREBLE, pre_gettreb());
-	update_display(msg);
+	vfd_setcell(fmt_uint(0, vol, FMT_WIDTH2), ' ');
+	vfd_drawbar(3, VFD_NCELLS - 3, vol, PRE_MAXVOL);
+}
+
+/*
+ * shows the tone settings over the input name for a while, after a tone
+ * change from the status screen
+ */
+static void ui_showtone() {
+	layer_hide(LAYER_VOLUME);
+	layer_show(LAYER_TONE, ui_drawtone, UI_HOLD_TIME);
+}
+
+/*
+ * draws bass and treble side by side (the tone layer)
+ */
+static void ui_drawtone() {
+	fmt_clear(fmt_int(fmt_label_P(0, LANG_TL_BASS), pre_getbass(), FMT_SIGN));
+	fmt_clear(fmt_int(fmt_label_P(VFD_NCELLS / 2, LANG_TL_TREBLE), pre_gettreb(), FMT_SIGN));
+}
+
+/*
+ * shows the mute icon over the status screen while muted
+ */
+static void ui_showmute() {
+	if(pre_getmute()) {
+		layer_show(LAYER_MUTE, ui_drawmute, 0);
+	} else {
+		layer_hide(LAYER_MUTE);
+	}
+}
+
+/*
+ * draws the mute icon in the last cell (the mute layer)
+ */
+static void ui_drawmute() {
+	vfd_setcell(VFD_NCELLS - 1, glyph_get(GLYPH_MUTE));
+}
+
+/*
+ * shows the ramp step
+ */
+static void ui_showramp() {
+	ui_showsetting(LANG_RAMP, pre_getramp(), 0);
 }
 
 /*
@@ -527,18 +995,14 @@ static void ui_showspeaker() {
  * shows the current active brightness setting
  */
 static void ui_showactivebrightness() {
-	char msg[17];
-	snprintf_P(msg, 17, LANG_ACTIVEBRIGHTNESS, vfd_getactivebrightness());
-	update_display(msg);
+	ui_showsetting(LANG_ACTIVEBRIGHTNESS, vfd_getactivebrightness(), 0);
 }
 
 /*
  * shows the current idle brightness setting
  */
 static void ui_showidlebrightness() {
-	char msg[17];
-	snprintf_P(msg, 17, LANG_IDLEBRIGHTNESS, vfd_getidlebrightness());
-	update_display(msg);
+	ui_showsetting(LANG_IDLEBRIGHTNESS, vfd_getidlebrightness(), 0);
 }
 
 /*
@@ -547,9 +1011,12 @@ static void ui_showidlebrightness() {
  */
 static void ui_buttonISR() { 
 	enum but_type pressed;
-	char msg[17];	// buffer to reduce flicker while adjusting volume
+	uint8_t steps;	// merged encoder steps, applied as one change
+	
+	pressed = but_popn(&steps);
 	
-	pressed = but_pop();
+	if(pressed == (BUT_BACK|BUT_HELD)) pressed = BUT_MUTE;	// the local way to mute
+	if(pressed & (BUT_HELD|BUT_RELEASED)) return;	// only presses wake the UI
 	
 	if(pressed != BUT_NONE) {
 		vfd_activebrightness();	// set VFD to active brightness
@@ -557,22 +1024,44 @@ static void ui_buttonISR() {
 		switch(pressed) {
 		case BUT_VOLINC:
 		case BUT_DIRRIGHT:
-			snprintf_P(msg, 17, LANG_VOLUME, pre_increasevol());
-			update_display(msg);
+			pre_changevol(steps);
+			ui_showvolume();
+			ui_showmute();		// changing the volume unmutes
 			break;
 		case BUT_VOLDEC:
 		case BUT_DIRLEFT:
-			snprintf_P(msg, 17, LANG_VOLUME, pre_decreasevol());
-			update_display(msg);
+			pre_changevol(-steps);
+			ui_showvolume();
+			ui_showmute();
+			break;
+		case BUT_MUTE:
+			pre_setmute(!pre_getmute());
+			ui_showmute();
+			break;
+		case BUT_BASSINC:
+			pre_changebass(steps);
+			ui_showtone();
+			break;
+		case BUT_BASSDEC:
+			pre_changebass(-steps);
+			ui_showtone();
+			break;
+		case BUT_TREBINC:
+			pre_changetreb(steps);
+			ui_showtone();
+			break;
+		case BUT_TREBDEC:
+			pre_changetreb(-steps);
+			ui_showtone();
 			break;
 		case BUT_DIRUP:
 		case BUT_SELUPL:
-			pre_previnput();
+			while(steps--) pre_previnput();
 			ui_showinput();
 			break;
 		case BUT_DIRDN:
 		case BUT_SELDNR:
-			pre_nextinput();
+			while(steps--) pre_nextinput();
 			ui_showinput();
 			break;
 		case BUT_ENTER:
@@ -582,6 +1071,7 @@ static void ui_buttonISR() {
 			ui_showinput();		// go back to regular display
 			break;
 		}
-		idle_timeout = UI_HOLD_TIME;
+		ui_inputtime = tick_now();
+		ui_idlepending = 1;
 	}
 }
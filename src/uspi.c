@@ -0,0 +1,128 @@
+/*
+ * uspi.c - USART0 SPI master for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Second SPI channel on USART0 (master SPI mode)
+ *
+ * The channel has a queue of its own, drained by the data register empty
+ * interrupt.  The transmitter is double buffered, so the next byte is
+ * loaded while one is shifting and a transfer goes out without gaps; the
+ * transmit complete interrupt then deselects the device once the last
+ * byte has left.  No other user shares the channel, so there is no
+ * arbitration.
+ */ 
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stddef.h>
+#include "uspi.h"
+#include "pins.h"
+
+#ifdef POT_USART
+
+// transfer queue, filled like spi.c's and drained by the USART interrupts
+static struct spi_xfer * volatile uspi_queue[USPI_QLEN];
+static volatile uint8_t uspi_qhead = 0;
+static volatile uint8_t uspi_qtail = 0;
+
+static struct spi_xfer * volatile uspi_cur = NULL;	// transfer being sent
+static volatile uint8_t uspi_pos;			// next byte of uspi_cur
+
+static void uspi_next();
+static void uspi_loadbyte();
+static void uspi_finished();
+
+void uspiinit() {
+	UBRR0 = 0;				// baud rate must be zero while the transmitter is enabled
+	DDRD |= 1<<USPI_XCK;	// XCK output selects master mode
+	UCSR0C = (1<<UMSEL01)|(1<<UMSEL00);	// master SPI, mode 0, MSB first
+	UCSR0B = 1<<TXEN0;		// transmit only; TXD0 is driven by the USART
+	UBRR0 = USPI_UBRR;
+}
+
+void uspi_submit(struct spi_xfer * xfer) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		uspi_queue[uspi_qhead++ & (USPI_QLEN - 1)] = xfer;
+		uspi_next();
+	}
+}
+
+/*
+ * Starts the transfer at the head of the queue, unless one is being sent
+ * or the queue is empty.  Interrupts must be disabled.
+ */
+static void uspi_next() {
+	if(uspi_cur != NULL || uspi_qhead == uspi_qtail) return;
+	uspi_cur = uspi_queue[uspi_qtail & (USPI_QLEN - 1)];
+	uspi_pos = 0;
+	PORTB &= ~(1<<uspi_cur->dev->cs);	// select the device
+	UCSR0B = (1<<TXEN0)|(1<<UDRIE0);	// load bytes from the interrupt
+}
+
+/*
+ * Data register empty: loads the next byte.  With the last one loaded,
+ * waits for it to leave the shift register.  Interrupts must be disabled.
+ */
+static void uspi_loadbyte() {
+	uint8_t c = uspi_cur->buf[uspi_pos++];
+	
+	if(uspi_pos < uspi_cur->len) {
+		UDR0 = c;
+		return;
+	}
+	UCSR0A = 1<<TXC0;		// the shifter may have run dry between bytes
+	UDR0 = c;
+	if(UCSR0A & (1<<TXC0)) {
+		UCSR0A = 1<<TXC0;	// it ran dry just before the last byte went in, which can't be out yet
+	}
+	UCSR0B = (1<<TXEN0)|(1<<TXCIE0);
+}
+
+/*
+ * Transmit complete: the last byte is out, so the device can latch it.
+ * Interrupts must be disabled.
+ */
+static void uspi_finished() {
+	struct spi_xfer * xfer = uspi_cur;
+	
+	UCSR0B = 1<<TXEN0;
+	PORTB |= 1<<xfer->dev->cs;	// deselect the device
+	uspi_cur = NULL;
+	uspi_qtail++;
+	if(xfer->done != NULL) xfer->done(xfer);
+	uspi_next();
+}
+
+void uspi_poll() {
+	if((UCSR0B & (1<<UDRIE0)) && (UCSR0A & (1<<UDRE0))) {
+		uspi_loadbyte();
+	} else if((UCSR0B & (1<<TXCIE0)) && (UCSR0A & (1<<TXC0))) {
+		UCSR0A = 1<<TXC0;	// the interrupt would have cleared it
+		uspi_finished();
+	}
+}
+
+ISR(USART_UDRE_vect) {
+	uspi_loadbyte();
+}
+
+ISR(USART_TX_vect) {
+	uspi_finished();
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * uspi.h - USART0 SPI master for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Build with -DPOT_USART to drive the pots from USART0 in master SPI
+ * mode (SCK on XCK0/PD4, SI on TXD0/PD1, CS still on POT_CS) instead of
+ * the SPI bus, so a pot update never waits behind a display frame.  The
+ * channel only sends, in mode 0, MSB first.
+ */ 
+
+#ifndef USPI_H_
+#define USPI_H_
+
+#include <stdint.h>
+#include "spi.h"
+
+#define USPI_QLEN 2			// transfer queue length, must be a power of two
+#define USPI_UBRR 0			// SCK is F_CPU / (2 * (USPI_UBRR + 1))
+
+#ifdef POT_USART
+
+// sets up USART0 as an SPI master
+void uspiinit();
+
+/* Queues a transfer and returns at once, like spi_submit(), but sends it
+   on USART0.  Only the device's chip select is used; its SPCR setting and
+   flags are ignored, and its chip select is set up with spi_devinit().
+   The queue holds USPI_QLEN transfers. */
+void uspi_submit(struct spi_xfer * xfer);
+
+// drives the queue while interrupts are disabled, as at startup
+void uspi_poll();
+
+#endif
+
+#endif /* USPI_H_ */
@@ -24,40 +24,133 @@
 #include <avr/io.h>
 #include <avr/eeprom.h>
 #include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <stdio.h>
 #include <string.h>
 #include "pins.h"
 #include "vfd.h"
 #include "spi.h"
 #include "lang.h"
+#include "latency.h"
+#include "bench.h"
+#include "glyph.h"
+#include "eedata.h"
 
 // EEPROM brightness data
 static uint8_t EEMEM ee_activebrightness = 8;
 static uint8_t EEMEM ee_idlebrightness = 1;
+// the SPI speed is in ee_data
 
 // volatile RAM copies
 static volatile uint8_t ram_activebrightness = 8;
 static volatile uint8_t ram_idlebrightness = 1;
+static uint8_t ram_spispeed = SPI_SPEEDUNKNOWN;
+
+/*
+ * Shadow framebuffer.
+ * Frames are drawn into vfd_frame.  vfd_commit() copies it to vfd_next,
+ * and at most every VFD_FRAMETIME ticks vfd_next goes to vfd_out and the
+ * transmitter is started.  It queues a burst of only the cells of vfd_out
+ * that differ from vfd_shown, what the display is known to hold.  A frame
+ * started while a burst is still going out follows on the first tick after
+ * it is done.
+ */
+static char vfd_frame[VFD_NCELLS];
+static char vfd_next[VFD_NCELLS];		// latest committed frame, waiting for its turn
+static char vfd_out[VFD_NCELLS];		// frame being sent
+static char vfd_shown[VFD_NCELLS];
+static uint8_t vfd_cursor = VFD_NCELLS;	// display's cursor position (VFD_NCELLS: unknown)
+
+/*
+ * Brightness is shadowed like the cells: the transmitter sends a change
+ * of vfd_dimmer ahead of any frame cells.  Both the UI loop and the tick
+ * (fading, waking) set it.
+ */
+static volatile uint8_t vfd_dimmer = 8;	// wanted brightness, 0 to 8
+static uint8_t vfd_dimshown = 8;		// brightness the display has (VFD_DIMUNKNOWN: powered on, level unknown)
+
+/*
+ * Fade.  The tick moves vfd_dimmer one level towards vfd_fadetarget
+ * every vfd_fadestep ticks.
+ */
+static uint8_t vfd_fadetarget;
+static uint16_t vfd_fadestep;			// ticks per level
+static volatile uint16_t vfd_fadetime = 0;	// ticks until the next level (0: not fading)
+
+/*
+ * Transmitter.  Bursts are built in vfd_txbuf and sent by the SPI queue;
+ * the display holds SCK low while it digests each byte.
+ */
+static struct spi_device vfd_spi = SPI_DEVICE(VFD_CS, SPI_MSBFIRST, SPI_MODE3, SPI_CKDIV4, SPI_HANDSHAKE);
+static uint8_t vfd_txbuf[VFD_TXLEN];
+static void vfd_burstsent(struct spi_xfer * xfer);
+static struct spi_xfer vfd_xfer = {&vfd_spi, vfd_txbuf, 0, vfd_burstsent};
+
+// transmitter state, shared with the SPI and tick interrupts
+static volatile uint8_t vfd_busy = 0;		// nonzero while a burst is queued or being sent
+static volatile uint8_t vfd_again = 0;		// nonzero if there may be more to send after it
+static volatile uint8_t vfd_intxn = 0;		// nonzero during a blocking transaction
+
+/*
+ * Marquee.
+ * Text too long for the display is kept here, already mapped to display
+ * characters, and the tick moves a window across it one cell at a time by
+ * rewriting vfd_out.  The transmitter then resends only the cells that
+ * changed.  Any vfd_commit() stops it.  The user characters it maps to
+ * stay loaded while it runs (see vfd_userchars()).
+ */
+static char vfd_marquee[VFD_MARQUEELEN];
+static volatile uint8_t vfd_marqlen = 0;	// length of the marquee text (0: not scrolling)
+static uint8_t vfd_marqkept = 0;		// marquee characters whose user characters must stay loaded
+static uint8_t vfd_marqpos;				// marquee character in the first cell
+static uint16_t vfd_marqtime;			// ticks until the next step
+
+/*
+ * Frame pacing.  A frame committed sooner than VFD_FRAMETIME after the
+ * last one started is held in vfd_next for the tick to start; committing
+ * again meanwhile replaces it, and the replaced frame counts as skipped.
+ */
+static volatile uint8_t vfd_held = 0;		// nonzero while vfd_next waits
+static volatile uint8_t vfd_frameage = VFD_FRAMETIME;	// ticks since the last frame started, up to VFD_FRAMETIME
+
+// statistics
+static uint32_t vfd_frames = 0;			// frames committed
+static uint32_t vfd_skipped = 0;		// frames replaced before they were sent
+static uint32_t vfd_sent = 0;			// frame bytes actually sent
 
 static void vfd_load();
+static void vfd_sendsetup();
+static uint16_t vfd_probe();
+static uint16_t vfd_timedwrite(char d);
+static char vfd_cellchar(char c);
+static void vfd_start();
+static uint8_t vfd_build();
+static void vfd_scroll(const char * msg);
+static void vfd_scrollstep();
+static uint16_t vfd_userbit(char c);
+static void vfd_wait();
+static void vfd_flush();
+#ifdef BENCH
+static void vfd_clearperbyte();
+#endif
 
 void vfdinit() {
-	PORTB |= (1<<VFD_CS);	// CS is high (disabled) until putd()
-	DDRB |= (1<<VFD_CS);	// chip select (CS) is output
+	spi_devinit(&vfd_spi);
 	
-	vfd_putd(VFD_POWEROFF);	// blank the display
-	vfd_putd(VFD_SETLENGTH | 0x07);	// 16 digits
-	vfd_putd(VFD_SETDIMMER | 0x07); // full brightness to ensure lit display
-	vfd_putd(0xF7);			// fast display frequency
-	vfd_putd(VFD_POWERON);	// turn on display
-	vfd_putd(VFD_SETINCREM | 0x01);	// enable auto-increment (should already be enabled, usually) 
-	vfd_putd(VFD_SETCURSOR);	// reset cursor
+	vfd_begin();
+	vfd_sendsetup();
+	vfd_end();
 	
+#ifdef BENCH
+	vfd_clearperbyte();			// baseline for BENCH_VFDCLEAR
+#endif
 	vfd_clear();
 	
-	vfd_load();					// load brightness values from EEPROM
+	vfd_load();					// load brightness values and SPI speed from EEPROM
 	
 	center_display_P(LANG_SPLASH);	// show splash message
+	vfd_wait();					// and send it before the pots need the bus
 }
 
 uint8_t vfd_getactivebrightness() {
@@ -78,38 +171,223 @@ void vfd_save() {
 static void vfd_load() {
 	ram_activebrightness = eeprom_read_byte(&ee_activebrightness);
 	ram_idlebrightness = eeprom_read_byte(&ee_idlebrightness);
+	ram_spispeed = eeprom_read_byte(&ee_data.vfdspispeed);
+	if(ram_spispeed < SPI_NSPEEDS) {
+		spi_setspeed(&vfd_spi, ram_spispeed);
+	} else {
+		ram_spispeed = SPI_SPEEDUNKNOWN;	// not calibrated yet: keep the default
+	}
+}
+
+/*
+ * Sends the display its settings within a transaction
+ */
+static void vfd_sendsetup() {
+	vfd_write(VFD_POWEROFF);	// blank the display
+	vfd_write(VFD_SETLENGTH | 0x07);	// 16 digits
+	vfd_write(VFD_SETDIMMER | 0x07); // full brightness to ensure lit display
+	vfd_write(0xF7);			// fast display frequency
+	vfd_write(VFD_POWERON);	// turn on display
+	vfd_write(VFD_SETINCREM | 0x01);	// enable auto-increment (should already be enabled, usually) 
+	vfd_write(VFD_SETCURSOR);	// reset cursor
+	vfd_dimshown = 8;
+	vfd_cursor = 0;
+}
+
+uint8_t vfd_getspispeed() {
+	return ram_spispeed;
+}
+
+/*
+ * Finds the fastest SCK the display keeps up with.  Starting from the
+ * slowest speed, the cells it shows are written to it again at each
+ * faster speed, until it fails to let go of SCK within VFD_CALTIMEOUT
+ * after a byte.  The display can't be read back, so its handshake is the
+ * only check.  Chip select goes high between speeds, which resets the
+ * display's serial input after a failure.
+ * A speed at the edge may keep up with the handshake yet garble data, so
+ * the display is then set up again one speed slower than the fastest that
+ * passed and cleared, and that speed is saved.  Times with Timer1, so
+ * reminit() must have run.
+ * Returns the longest SCK release turnaround seen at that speed, in
+ * microseconds.
+ */
+uint16_t vfd_calibrate() {
+	uint8_t speed = SPI_NSPEEDS;
+	uint16_t turnaround = VFD_CALTIMEOUT;	// at speed
+	uint16_t slower = VFD_CALTIMEOUT;		// at the speed before it
+	uint16_t t;
+	
+	vfd_begin();			// holds the transmitter off throughout
+	while(speed > 0) {
+		spi_end(&vfd_spi);
+		spi_setspeed(&vfd_spi, speed - 1);
+		spi_begin(&vfd_spi);
+		t = vfd_probe();
+		if(t >= VFD_CALTIMEOUT) break;
+		speed--;
+		slower = turnaround;
+		turnaround = t;
+	}
+	if(speed >= SPI_NSPEEDS) {
+		speed = VFD_SPIDEFAULT;		// not even the slowest passed
+	} else if(speed < SPI_NSPEEDS - 1) {
+		speed++;					// keep a step of margin
+		turnaround = slower;
+	}
+	ram_spispeed = speed;
+	
+	spi_end(&vfd_spi);
+	spi_setspeed(&vfd_spi, speed);
+	spi_begin(&vfd_spi);
+	vfd_sendsetup();		// undo anything a failed speed garbled
+	vfd_end();
+	glyphinit();			// user characters may be garbled too
+	vfd_clear();
+	vfd_start();			// restore the brightness
+	
+	PORTB |= 1<<EE_LED;		// turn on EEPROM access LED
+	eeprom_update_byte(&ee_data.vfdspispeed, ram_spispeed);
+	PORTB &= ~(1<<EE_LED);	// turn off EEPROM access LED
+	return turnaround;
+}
+
+/*
+ * Writes the cells the display shows back to it, within a transaction.
+ * Returns the longest the display held SCK after a byte, in microseconds,
+ * or VFD_CALTIMEOUT if it held it too long.
+ */
+static uint16_t vfd_probe() {
+	uint16_t worst;
+	uint16_t t;
+	
+	worst = vfd_timedwrite(VFD_SETCURSOR);
+	for(uint8_t i = 0; i < VFD_NCELLS && worst < VFD_CALTIMEOUT; i++) {
+		t = vfd_timedwrite(vfd_shown[i]);
+		if(t > worst) worst = t;
+	}
+	vfd_cursor = VFD_NCELLS;	// auto-increment has run off the end
+	return worst;
+}
+
+/*
+ * Sends one byte within a transaction like vfd_write(), but gives up
+ * waiting for the display after VFD_CALTIMEOUT.
+ * Returns how long the display held SCK, in microseconds (at most
+ * VFD_CALTIMEOUT).
+ */
+static uint16_t vfd_timedwrite(char d) {
+	uint16_t start;
+	uint16_t t;
+	
+	spi_transfer(d);
+	start = TCNT1;
+	DDRB &= ~(1<<SPI_SCK);	// SCK is now input w/pullup
+	do {
+		t = TCNT1 - start;
+		if(t >= VFD_CALTIMEOUT) return VFD_CALTIMEOUT;
+	} while((PINB & (1<<SPI_SCK)) == 0);
+	return t;
 }
 
 void vfd_putd(char d) {
-	spiinit(SPI_MSBFIRST, SPI_MODE3, SPI_CKDIV4);// set VFD spi mode
-	PORTB &= ~(1<<VFD_CS);	// select VFD chipselect
+	vfd_begin();
+	vfd_write(d);
+}
+
+/*
+ * Starts a transaction: lets the transmitter finish and holds it off,
+ * then takes the bus for the display.
+ */
+void vfd_begin() {
+	uint8_t held = 0;
+	
+	while(!held) {
+		vfd_wait();
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// the tick may have started it again
+			if(!vfd_busy) {
+				vfd_intxn = 1;
+				held = 1;
+			}
+		}
+	}
+	spi_begin(&vfd_spi);
+}
+
+/*
+ * Sends one byte within a transaction and waits for the display to take it
+ */
+void vfd_write(char d) {
 	spi_transfer(d);		// shift out data
 	DDRB &=~(1<<SPI_SCK);	// SCK is now input w/pullup
 	while((PINB & (1<<SPI_SCK)) == 0);	// wait for VFD to release clock line
 }
 
+/*
+ * Ends a transaction, releasing the display and the bus
+ */
+void vfd_end() {
+	spi_end(&vfd_spi);
+	vfd_intxn = 0;
+	if(vfd_again) vfd_start();		// the transmitter was held off meanwhile
+}
+
 int vfd_putchar(char c) {
-	if(c < 0x20 || c > 0x7f) c = 0x7f;	// make invalid chars obvious
+	c = vfd_cellchar(c);
 	vfd_putd(c);
-	PORTB |= (1<<VFD_CS);	// clear VFD chipselect
+	if(vfd_cursor < VFD_NCELLS) {	// keep track of what the display holds
+		vfd_out[vfd_cursor] = vfd_shown[vfd_cursor] = c;
+		vfd_cursor++;
+	}
+	vfd_end();
 	return 0;
 }
 
 void vfd_setcursor(uint8_t cursor_pos) {
 	cursor_pos &= 0x0f;		// protect from invalid cursor_pos
 	vfd_putd(VFD_SETCURSOR | cursor_pos);
-	PORTB |= (1<<VFD_CS);	// clear VFD chipselect
+	vfd_cursor = cursor_pos;
+	vfd_end();
 }
 
 void vfd_setbrightness(uint8_t brightness) {
-	if(brightness == 0) {
-		vfd_putd(VFD_POWEROFF);	// blank the display at brightness 0
-	} else {
-		vfd_putd(VFD_POWERON);	// make sure display is on at nonzero brightness
-		brightness = (brightness - 1) & 0x07;		// convert to dimmer value
-		vfd_putd(VFD_SETDIMMER | brightness);
+	vfd_fadeto(brightness, 0);
+}
+
+/*
+ * Fades to a brightness, one level at a time spread over about ms
+ * milliseconds.  Any fade already running is cancelled.
+ */
+void vfd_fadeto(uint8_t brightness, uint16_t ms) {
+	uint8_t levels;
+	
+	if(brightness > 8) brightness = 8;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// the tick fades and wakes
+		levels = (brightness > vfd_dimmer) ? brightness - vfd_dimmer : vfd_dimmer - brightness;
+		if(ms < levels) {		// too quick to fade
+			vfd_dimmer = brightness;
+			vfd_fadetime = 0;
+		} else if(levels != 0) {
+			vfd_fadetarget = brightness;
+			vfd_fadestep = ms / levels;
+			vfd_fadetime = vfd_fadestep;
+		} else {
+			vfd_fadetime = 0;
+		}
+	}
+	vfd_start();
+}
+
+/*
+ * Cancels any fade and goes straight to active brightness.
+ * Called from the tick as soon as input arrives.
+ */
+void vfd_wake() {
+	if(vfd_fadetime != 0 || vfd_dimmer != ram_activebrightness) {
+		vfd_fadetime = 0;
+		vfd_dimmer = ram_activebrightness;
+		vfd_start();
 	}
-	PORTB |= (1<<VFD_CS);	// clear VFD chipselect
 }
 
 void vfd_activebrightness() {
@@ -129,7 +407,7 @@ uint8_t vfd_decreaseactivebrightness() {
 }
 
 void vfd_idlebrightness() {
-	vfd_setbrightness(ram_idlebrightness);
+	vfd_fadeto(ram_idlebrightness, VFD_FADETIME);
 }
 
 uint8_t vfd_increaseidlebrightness() {
@@ -143,53 +421,421 @@ uint8_t vfd_decreaseidlebrightness() {
 }
 
 
+/*
+ * Clears the display in one transaction.  A held frame and the marquee
+ * are dropped too, as they may use user characters from before it.
+ */
 void vfd_clear() {
-	vfd_setcursor(0);
-	for(int i = 0; i < 16; i++) {
-		vfd_putd(' ');
+	vfd_wait();				// a frame still going out isn't part of the clear
+	BENCH_BEGIN();
+	vfd_begin();
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// the tick flushes and scrolls
+		vfd_held = 0;
+		vfd_marqlen = 0;
+	}
+	vfd_marqkept = 0;
+	vfd_write(VFD_SETCURSOR);
+	for(uint8_t i = 0; i < VFD_NCELLS; i++) {
+		vfd_write(' ');
+		vfd_frame[i] = vfd_next[i] = vfd_out[i] = vfd_shown[i] = ' ';
 	}
-	vfd_setcursor(0);	// vfd_setcursor releases chipselect
+	vfd_write(VFD_SETCURSOR);
+	vfd_cursor = 0;
+	vfd_end();
+	BENCH_END(BENCH_VFDCLEAR);
 }
 
-// updates display quickly
-void update_display(const char * msg) {
-	uint8_t i = 0;
-	vfd_setcursor(0);
-	while(i < 16 && msg[i] != 0) {
-		vfd_putchar(msg[i]);
-		i++;
+#ifdef BENCH
+/*
+ * Sends one byte in a transaction of its own, setting the bus up again
+ * as spiinit() used to before every byte
+ */
+static void vfd_putalone(char d) {
+	vfd_begin();
+	SPCR = vfd_spi.spcr;
+	SPSR = vfd_spi.spsr;
+	vfd_write(d);
+	vfd_end();
+}
+
+/*
+ * Sends the same frame as vfd_clear() the way every frame was sent before
+ * transactions: bus setup and chip select for each of its bytes.  Kept
+ * only to time it against vfd_clear().
+ */
+static void vfd_clearperbyte() {
+	vfd_wait();				// time it on an idle bus, as vfd_clear() is
+	BENCH_BEGIN();
+	vfd_putalone(VFD_SETCURSOR);
+	for(uint8_t i = 0; i < VFD_NCELLS; i++) {
+		vfd_putalone(' ');
+	}
+	vfd_putalone(VFD_SETCURSOR);
+	vfd_cursor = 0;
+	BENCH_END(BENCH_VFDPERBYTE);
+}
+#endif
+
+/*
+ * Hands the frame in vfd_frame to the transmitter and returns at once.
+ * Only the cells that differ from what the display holds are sent.  Each
+ * run of changed cells costs a cursor jump (unless the cursor is already
+ * there) plus its characters.  A jump never costs more than resending the
+ * unchanged cells it skips, so a frame never costs more than the full
+ * rewrite it replaces.
+ * Frames come at most every VFD_FRAMETIME ticks; one committed sooner is
+ * started by the tick, unless a newer one replaces it first.
+ */
+void vfd_commit() {
+	uint8_t now = 0;
+	
+	BENCH_BEGIN();
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {	// the tick reads vfd_next
+		for(uint8_t i = 0; i < VFD_NCELLS; i++) {
+			vfd_next[i] = vfd_frame[i];
+		}
+		if(vfd_held) vfd_skipped++;
+		vfd_held = 1;
+		vfd_marqlen = 0;		// a new frame replaces any marquee
+		vfd_marqkept = 0;
+		vfd_frames++;
+		if(vfd_frameage >= VFD_FRAMETIME) {
+			vfd_flush();
+			now = 1;
+		}
+	}
+	if(now) vfd_start();
+	BENCH_END(BENCH_VFDCOMMIT);
+}
+
+/*
+ * Makes the held frame the one to send; the caller then starts the
+ * transmitter.  Interrupts must be disabled, or it must be called from
+ * the tick.
+ */
+static void vfd_flush() {
+	for(uint8_t i = 0; i < VFD_NCELLS; i++) {
+		vfd_out[i] = vfd_next[i];
+	}
+	vfd_held = 0;
+	vfd_frameage = 0;
+}
+
+/*
+ * Gets the number of bytes vfd_commit() has saved over rewriting the
+ * whole display for every frame
+ */
+uint32_t vfd_getsaved() {
+	uint32_t full = (uint32_t)vfd_frames * (VFD_NCELLS + 1);	// cursor reset plus every cell
+	uint32_t sent;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		sent = vfd_sent;
+	}
+	return (full > sent) ? full - sent : 0;
+}
+
+/*
+ * Gets the number of frames replaced by a newer one before they were
+ * sent
+ */
+uint32_t vfd_getskipped() {
+	uint32_t skipped;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		skipped = vfd_skipped;
+	}
+	return skipped;
+}
+
+/*
+ * Waits until the transmitter has sent its burst.  Before interrupts are
+ * enabled at startup, it drives the SPI queue itself.
+ */
+static void vfd_wait() {
+	while(vfd_busy) {
+		if(!(SREG & (1<<SREG_I))) spi_poll();
+	}
+}
+
+/*
+ * Starts the transmitter if it is idle and has anything to send.  If it
+ * is busy, or a transaction has the display, it starts again once that
+ * is over.  The burst is built with interrupts as the caller left them,
+ * so call it outside ATOMIC_BLOCKs.
+ */
+static void vfd_start() {
+	uint8_t len;
+	uint8_t mine = 0;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(vfd_busy || vfd_intxn) {
+			vfd_again = 1;
+		} else {
+			vfd_again = 0;
+			vfd_busy = 1;		// the transmitter is ours while we build
+			mine = 1;
+		}
+	}
+	if(!mine) return;
+	
+	len = vfd_build();
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(len != 0) {
+			vfd_xfer.len = len;
+			LAT_START(LAT_VFD);
+			spi_submit(&vfd_xfer);
+		} else {
+			vfd_busy = 0;
+		}
+	}
+}
+
+/*
+ * Called from the SPI interrupt once a burst has gone out.  Anything that
+ * came up meanwhile is left for the tick, so the burst is never built in
+ * the interrupt.
+ */
+static void vfd_burstsent(struct spi_xfer * xfer) {
+	vfd_busy = 0;
+	LAT_MARK(LAT_VFD);
+}
+
+/*
+ * Builds the next burst for the display in vfd_txbuf: brightness changes
+ * first, then each changed cell of vfd_out (after a cursor jump to it,
+ * unless the cursor is already there).  What the display holds is
+ * updated as if the burst had been sent.
+ * Returns the length of the burst.  Only vfd_start() calls it, while it
+ * holds vfd_busy; the tick may change vfd_out or the dimmer meanwhile,
+ * and its vfd_start() then leaves vfd_again for the next burst.
+ */
+static uint8_t vfd_build() {
+	uint8_t n = 0;
+	uint8_t dimmer = vfd_dimmer;
+	uint8_t i;
+	
+	if(dimmer != vfd_dimshown) {
+		if(dimmer == 0) {
+			vfd_txbuf[n++] = VFD_POWEROFF;	// blank the display at brightness 0
+		} else {
+			if(vfd_dimshown == 0) vfd_txbuf[n++] = VFD_POWERON;	// turn it back on first
+			vfd_txbuf[n++] = VFD_SETDIMMER | (dimmer - 1);	// dimmer value is brightness - 1
+		}
+		vfd_dimshown = dimmer;
+	}
+	
+	for(i = 0; i < VFD_NCELLS; i++) {
+		char c = vfd_out[i];
+		
+		if(c == vfd_shown[i]) continue;
+		if(vfd_cursor != i) {
+			vfd_txbuf[n++] = VFD_SETCURSOR | i;
+			vfd_sent++;
+		}
+		vfd_txbuf[n++] = c;
+		vfd_shown[i] = c;
+		vfd_cursor = i + 1;		// auto-increment
+		vfd_sent++;
+	}
+	return n;
+}
+
+/*
+ * Starts a held frame when its turn comes, steps the fade and the
+ * marquee, and restarts the transmitter if anything was left for it.
+ * Called from the tick interrupt with interrupts enabled.
+ */
+void vfd_tick() {
+	if(vfd_frameage < VFD_FRAMETIME) {
+		vfd_frameage++;
+	} else if(vfd_held) {
+		vfd_flush();
+		vfd_start();
+	}
+	if(vfd_fadetime != 0 && --vfd_fadetime == 0) {
+		if(vfd_dimmer < vfd_fadetarget) {
+			vfd_dimmer++;
+		} else {
+			vfd_dimmer--;
+		}
+		if(vfd_dimmer != vfd_fadetarget) vfd_fadetime = vfd_fadestep;
+		vfd_start();
+	}
+	if(vfd_marqlen != 0 && --vfd_marqtime == 0) {
+		vfd_scrollstep();
+	}
+	if(vfd_again && !vfd_busy) vfd_start();	// a burst finished with more to send
+}
+
+/*
+ * Moves the marquee window one cell along and hands it to the transmitter.
+ * The text comes round again after a gap, and pauses at the start.
+ * Called from the tick.
+ */
+static void vfd_scrollstep() {
+	uint8_t span = vfd_marqlen + VFD_SCROLLGAP;
+	uint8_t j;
+	
+	if(++vfd_marqpos >= span) vfd_marqpos = 0;
+	vfd_marqtime = (vfd_marqpos == 0) ? VFD_SCROLLPAUSE : VFD_SCROLLTIME;
+	
+	j = vfd_marqpos;
+	for(uint8_t i = 0; i < VFD_NCELLS; i++) {
+		vfd_out[i] = (j < vfd_marqlen) ? vfd_marquee[j] : ' ';
+		if(++j >= span) j = 0;
+	}
+	vfd_start();
+}
+
+/*
+ * Shows msg from the first cell, scrolling it through the display with
+ * the tick if it is too long to fit
+ */
+static void vfd_scroll(const char * msg) {
+	uint8_t l = 0;
+	
+	vfd_marqlen = 0;				// stop the tick using vfd_marquee
+	vfd_marqkept = 0;
+	while(l < VFD_MARQUEELEN && msg[l] != 0) {
+		vfd_marquee[l] = vfd_cellchar(msg[l]);
+		l++;
+		vfd_marqkept = l;			// keep them loaded while mapping the rest
+	}
+	for(uint8_t i = 0; i < VFD_NCELLS; i++) {
+		vfd_frame[i] = (i < l) ? vfd_marquee[i] : ' ';
 	}
-	while(i < 16) {
-		vfd_putchar(' ');
-		i++;
+	vfd_commit();
+	if(l > VFD_NCELLS) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			vfd_marqpos = 0;
+			vfd_marqtime = VFD_SCROLLPAUSE;
+			vfd_marqlen = l;
+		}
+		vfd_marqkept = l;
 	}
 }
 
+/*
+ * Gets the user character slots the display still needs: those in the
+ * cells it holds, the frame being sent, the held frame and the marquee.
+ * The tick only moves characters between these, so they are read with
+ * interrupts enabled.
+ */
+uint16_t vfd_userchars() {
+	uint16_t used = 0;
+	uint8_t i;
+	
+	for(i = 0; i < VFD_NCELLS; i++) {
+		used |= vfd_userbit(vfd_shown[i]) | vfd_userbit(vfd_out[i]) | vfd_userbit(vfd_next[i]);
+	}
+	for(i = 0; i < vfd_marqkept; i++) {
+		used |= vfd_userbit(vfd_marquee[i]);
+	}
+	return used;
+}
+
+/*
+ * Gets the vfd_userchars() bit for a display character (0 if it is not a
+ * user character)
+ */
+static uint16_t vfd_userbit(char c) {
+	uint8_t slot = (uint8_t)c - VFD_USERCHAR;
+	
+	return (slot < VFD_NUSERCHARS) ? (uint16_t)1 << slot : 0;
+}
+
+/*
+ * Puts a character in a framebuffer cell
+ */
+void vfd_setcell(uint8_t pos, char c) {
+	if(pos < VFD_NCELLS) vfd_frame[pos] = vfd_cellchar(c);
+}
+
+/*
+ * Draws a bar graph in the framebuffer.  Each cell is VFD_GLYPHCOLS
+ * columns wide; the last lit cell uses a partial bar glyph.
+ */
+void vfd_drawbar(uint8_t pos, uint8_t cells, uint8_t value, uint8_t max) {
+	uint16_t lit;			// columns to light
+	
+	if(pos + cells > VFD_NCELLS) cells = VFD_NCELLS - pos;
+	if(value > max) value = max;
+	lit = max ? ((uint16_t)value * cells * VFD_GLYPHCOLS + max / 2) / max : 0;
+	
+	for(uint8_t i = pos; i < pos + cells; i++) {
+		if(lit >= VFD_GLYPHCOLS) {
+			vfd_frame[i] = VFD_BLOCK;
+			lit -= VFD_GLYPHCOLS;
+		} else if(lit > 0) {
+			vfd_frame[i] = glyph_get(GLYPH_BAR1 + lit - 1);
+			if(vfd_frame[i] == 0) vfd_frame[i] = ' ';	// no slot free for it
+			lit = 0;
+		} else {
+			vfd_frame[i] = ' ';
+		}
+	}
+}
+
+/*
+ * Converts a character to what the display will show for it.
+ * Latin-1 letters with a library glyph are loaded as user characters.
+ */
+static char vfd_cellchar(char c) {
+	char g;
+	
+	if((uint8_t)c >= VFD_USERCHAR && (uint8_t)c < VFD_USERCHAR + VFD_NUSERCHARS) {
+		return c;						// user characters are fine
+	}
+	if((uint8_t)c >= 0xa0 && (g = glyph_latin1(c)) != 0) return g;
+	if(c < 0x20 || c > 0x7f) c = 0x7f;	// make invalid chars obvious
+	return c;
+}
+
+// updates display quickly, scrolling msg if it is too long
+void update_display(const char * msg) {
+	vfd_scroll(msg);
+}
+
 // updates display quickly from program space
 void update_display_P(PGM_P msg_P) {
-	char msg[17];
-	strncpy_P(msg, msg_P, 17);
+	char msg[VFD_MARQUEELEN + 1];
+	strlcpy_P(msg, msg_P, sizeof(msg));
 	update_display(msg);
 }
 
-// displays msg centered
+// displays msg centered, or scrolling if it is too long
 void center_display(const char * msg) {
+	if(strlen(msg) > VFD_NCELLS) {
+		vfd_scroll(msg);
+		return;
+	}
+	vfd_drawcentered(msg);
+	vfd_commit();
+}
+
+/*
+ * Draws msg centered in the framebuffer, cut off if it is too long
+ */
+void vfd_drawcentered(const char * msg) {
 	uint8_t i;
 	uint8_t l = strlen(msg);
-	uint8_t o = (16 - l) / 2;
-	vfd_setcursor(0);
-	for(i = 0; i < 16; i++) {
+	uint8_t o;
+	
+	if(l > VFD_NCELLS) l = VFD_NCELLS;
+	o = (VFD_NCELLS - l) / 2;
+	for(i = 0; i < VFD_NCELLS; i++) {
 		if (i >= o && i - o < l) {
-			vfd_putchar(msg[i - o]);
+			vfd_frame[i] = vfd_cellchar(msg[i - o]);
 		} else {
-			vfd_putchar(' ');
+			vfd_frame[i] = ' ';
 		}
 	}
 }
 
 // displays centered from program space
 void center_display_P(PGM_P msg_P) {
-	char msg[17];
-	strncpy_P(msg, msg_P, 17);
+	char msg[VFD_MARQUEELEN + 1];
+	strlcpy_P(msg, msg_P, sizeof(msg));
 	center_display(msg);
 }
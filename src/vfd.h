@@ -42,6 +42,23 @@
 
 #define VFD_SETUSERCHAR 0xfc
 
+#define VFD_NCELLS 16		// characters on the display
+#define VFD_BLOCK 0x7f		// fully-lit block character
+#define VFD_USERCHAR 0x90	// first user-definable character
+#define VFD_NUSERCHARS 16	// number of user-definable characters
+#define VFD_GLYPHCOLS 5		// columns per character (and user character data bytes)
+#define VFD_DIMUNKNOWN 0xff	// brightness not known
+#define VFD_FADETIME 1000	// ms to fade to idle brightness
+#define VFD_FRAMETIME 40	// minimum ms between frames (25 per second), at most 255
+#define VFD_TXLEN (VFD_NCELLS + 3)	// longest burst: brightness, a cursor jump and every cell
+#define VFD_SPIDEFAULT 1	// SPI speed (F_CPU/4) until calibrated
+#define VFD_CALTIMEOUT 2000	// longest SCK hold, in microseconds, a calibrated speed may cause
+
+#define VFD_MARQUEELEN 40	// longest text the marquee scrolls
+#define VFD_SCROLLTIME 300	// ms per marquee step
+#define VFD_SCROLLPAUSE 1500	// ms the marquee rests at the start
+#define VFD_SCROLLGAP 3		// blank cells before the text comes round again
+
 // sets up VFD to sane settings
 void vfdinit();
 
@@ -50,12 +67,20 @@ int vfd_putchar(char c/*, FILE * stream*/);
 
 /* direct put function
    WARNING: This is for putting data to the VFD, and thus
-   doesn't release chipselect.  Be sure to release (make high) VFD_CS
-   before using the SPI bus for other purposes. The only
-   reason this should be used outside of vfd.c is to load
-   custom characters. */
+   doesn't end the transaction it starts.  Be sure to call vfd_end()
+   before using the SPI bus for other purposes.  Sending several bytes
+   is better done in a transaction. */
 void vfd_putd(char d);
 
+/* Transactions.
+   vfd_begin() waits for the background transmitter and takes the bus
+   for the display once; vfd_write() then sends each byte and vfd_end()
+   releases the display and the bus.  Use these to send a burst of commands
+   or data, such as a user character. */
+void vfd_begin();
+void vfd_write(char d);
+void vfd_end();
+
 // moves cursor to specified location
 void vfd_setcursor(uint8_t cursor_pos);
 
@@ -65,9 +90,17 @@ void vfd_setbrightness(uint8_t brightness);
 // sets the display to active brightness
 void vfd_activebrightness();
 
-// sets the display to idle brightness
+// fades the display to idle brightness over VFD_FADETIME
 void vfd_idlebrightness();
 
+/* fades the display to a brightness (0 to 8) over about ms milliseconds,
+   stepped from the tick.  Cancels any fade already running. */
+void vfd_fadeto(uint8_t brightness, uint16_t ms);
+
+/* cancels any fade and sets active brightness at once; called from the
+   tick when input arrives */
+void vfd_wake();
+
 // increases the active brightness of the VFD, if possible.  Returns new active brightness
 uint8_t vfd_increaseactivebrightness();
 
@@ -89,14 +122,56 @@ uint8_t vfd_getidlebrightness();
 // saves the brightnesses of the VFD
 void vfd_save();
 
+/* finds the fastest SPI speed the display keeps up with (see
+   spi_setspeed()) and saves the next slower one, then clears it.  Returns
+   the longest time the display held SCK after a byte at the saved speed,
+   in microseconds. */
+uint16_t vfd_calibrate();
+
+// gets the display's SPI speed, or SPI_SPEEDUNKNOWN if it has not been calibrated
+uint8_t vfd_getspispeed();
+
 /* clears display by overwriting all locations with space, then 
-   puts cursor at zero */
+   puts cursor at zero.  Drops any frame waiting to be sent and stops the
+   marquee. */
 void vfd_clear();
 
-// overwrites the display quickly
+/* hands the shadow framebuffer to the display and returns at once.  The
+   changed cells are sent in the background by the SPI interrupt.
+   Frames are paced to one per VFD_FRAMETIME: a frame committed sooner
+   waits for the tick, and only the latest waiting frame is sent.
+   update_display() and friends draw into the framebuffer and call this. */
+void vfd_commit();
+
+// puts character c in cell pos of the framebuffer
+void vfd_setcell(uint8_t pos, char c);
+
+// draws msg centered across the framebuffer, cut off if it is too long
+void vfd_drawcentered(const char * msg);
+
+/* draws a bar graph of value out of max in the framebuffer, across cells
+   cells from cell pos, to the nearest character column */
+void vfd_drawbar(uint8_t pos, uint8_t cells, uint8_t value, uint8_t max);
+
+/* gets a bit for each user character slot (bit 0: VFD_USERCHAR) that the
+   display shows, is about to show or may scroll in from the marquee.
+   glyph_get() doesn't reuse those slots. */
+uint16_t vfd_userchars();
+
+// gets the number of bytes vfd_commit() has saved over full rewrites
+uint32_t vfd_getsaved();
+
+// gets the number of committed frames skipped for a newer one
+uint32_t vfd_getskipped();
+
+// paces frames and steps the fade and the marquee; called from the tick interrupt
+void vfd_tick();
+
+/* overwrites the display quickly.  Text longer than the display scrolls
+   through it (up to VFD_MARQUEELEN characters) until the next frame. */
 void update_display(const char *);
 
-// prints a message centered on the display
+// prints a message centered on the display, scrolling it if it is too long
 void center_display(const char *);
 
 // same as update_display() but takes a string from program space
@@ -0,0 +1,35 @@
+/*
+ * avr/eeprom.h - Host stand-in for avr-libc's EEPROM access
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * EEMEM variables are ordinary variables, so the EEPROM starts out
+ * zeroed rather than erased, and forgets everything between runs.
+ */
+
+#ifndef SHIM_AVR_EEPROM_H_
+#define SHIM_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+#define eeprom_read_byte(p) (*(const uint8_t *)(p))
+#define eeprom_update_byte(p, v) (*(uint8_t *)(p) = (v))
+#define eeprom_read_block(dst, src, n) memcpy((dst), (src), (n))
+#define eeprom_update_block(src, dst, n) memcpy((dst), (src), (n))
+
+#endif /* SHIM_AVR_EEPROM_H_ */
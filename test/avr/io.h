@@ -0,0 +1,46 @@
+/*
+ * avr/io.h - Host stand-in for the AVR registers remote.c and buttons.c use
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Registers are plain variables defined in shim.c, which plays Timer1
+ * against them.  Only what the tested sources touch is here.
+ */
+
+#ifndef SHIM_AVR_IO_H_
+#define SHIM_AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t DDRB, PORTB;
+extern volatile uint8_t DDRC, PORTC, PINC;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, ICR1, OCR1A;
+
+// TCCR1B
+#define CS10 0
+#define ICES1 6
+#define ICNC1 7
+
+// TIMSK1
+#define OCIE1A 1
+#define ICIE1 5
+
+// TIFR1
+#define OCF1A 1
+#define ICF1 5
+
+#endif /* SHIM_AVR_IO_H_ */
@@ -0,0 +1,582 @@
+/*
+ * remtest.c - Host test of the IR receiver for AIA Control Board
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Replays IR traces through remote.c's Timer1 interrupt handlers, as the
+ * receiver would drive them on the board, and checks what lands in the
+ * button queue:
+ *  - synthesised frames of every protocol, clean and distorted, scored as
+ *    decoded to their button, dropped, or wrong
+ *  - capture files from captures/, each a short key press
+ *  - keys held, pressed again and learned, through auto-repeat and the
+ *    keymap
+ * It then times each decoder per edge on its own.  Exits nonzero if any
+ * check fails.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "buttons.h"
+#include "remote.h"
+#include "shim.h"
+#include "traces.h"
+
+#define REMTEST_FRAMES 500		// frames per protocol and case
+#define REMTEST_SEED 1
+#define REMTEST_WARMUP 100		// unscored frames per protocol first, so the first case isn't timed cold
+#define REMTEST_HISTLEN 1024	// per-edge times kept for percentiles; longer ones land in the last
+#define REMTEST_NKEYS 8			// keys learned per protocol
+#define REMTEST_QUIET 120000	// silence after a frame, long enough for the key to be released
+#define REMTEST_HELD 60			// frames sent while a key is held
+#define REMTEST_HELDSTEPS 53	// steps they make: 1 for the press, then 2+6+20+24 from rem_ramp
+
+// what a case must do for it to pass
+enum remtest_expect {
+	EXPECT_ALL,		// every frame decodes to its button (or none, if it has none)
+	EXPECT_NOWRONG,	// frames may be dropped, but never decode as anything else
+	EXPECT_NONE		// no frame decodes
+};
+
+enum remtest_case {
+	CASE_CLEAN,			// nominal timing
+	CASE_JITTER,		// every interval off by up to 10%
+	CASE_HEAVYJITTER,	// every interval off by up to 25%
+	CASE_NOISY,			// one interval split by a short glitch
+	CASE_TRUNCATED,		// cut short before the last bit
+	CASE_WRONGADDR,		// clean, but for another device, so no button
+	CASE_N
+};
+
+static const struct {
+	const char * name;
+	enum remtest_expect expect;
+} remtest_cases[CASE_N] = {
+	{"clean", EXPECT_ALL},
+	{"jitter 10%", EXPECT_ALL},
+	{"jitter 25%", EXPECT_NOWRONG},
+	{"noisy", EXPECT_NOWRONG},
+	{"truncated", EXPECT_NONE},
+	{"wrong address", EXPECT_ALL}
+};
+
+static const char * const remtest_protocols[REM_NPROTOCOLS] = {"SIRC", "NEC", "RC5"};
+
+// the address the board's keys are learned from, per protocol
+static const uint16_t remtest_device[REM_NPROTOCOLS] = {1, 0x04, 0x00};
+
+// the buttons the learned keys are bound to, one each
+static const enum but_type remtest_buttons[REMTEST_NKEYS] = {
+	BUT_ENTER, BUT_BACK, BUT_VOLINC, BUT_VOLDEC,
+	BUT_SELUPL, BUT_SELDNR, BUT_DIRLEFT, BUT_DIRRIGHT
+};
+
+// capture files and the key each holds; every one is a single short press
+static const struct {
+	const char * path;
+	struct rem_code code;
+	enum but_type button;	// bound to the key before the replay
+} remtest_captures[] = {
+	{"captures/sirc12.txt", {REM_PROTO_SIRC, 1, 0x12}, BUT_VOLINC},
+	{"captures/nec.txt", {REM_PROTO_NEC, 0x04, 0x02}, BUT_ENTER},
+	{"captures/rc5.txt", {REM_PROTO_RC5, 0x00, 0x10}, BUT_VOLDEC}
+};
+
+#define REMTEST_NCAPTURES (sizeof(remtest_captures) / sizeof(remtest_captures[0]))
+
+// results of one protocol and case
+struct remtest_result {
+	uint16_t decoded;		// frames that queued their button, or nothing if it has none
+	uint16_t dropped;		// frames nothing was decoded from
+	uint16_t wrong;			// frames that did anything else
+	uint64_t time;			// host time spent in the Timer1 interrupts
+};
+
+// what reached the button queue
+struct remtest_queue {
+	uint8_t events;
+	enum but_type type;		// of the first event
+	uint16_t steps;			// of all events of that type
+	uint8_t others;			// events of other types
+};
+
+// what each decoder's xxx_edge() cost, over every edge of every case
+static struct {
+	uint32_t edges;
+	uint64_t time;
+	uint32_t hist[REMTEST_HISTLEN];		// edges by time
+} remtest_cost[REM_NPROTOCOLS];
+
+static void (* const remtest_decoders[REM_NPROTOCOLS])(uint8_t mark, uint16_t length) = {
+	sirc_edge, nec_edge, rc5_edge
+};
+
+static struct rem_code remtest_keys[REMTEST_NKEYS];	// learned keys of the protocol under test
+static uint64_t remtest_overhead;
+
+static void remtest_learnkeys(enum rem_protocol protocol);
+static void remtest_frame(enum rem_protocol protocol, enum remtest_case c, struct remtest_result * r);
+static void remtest_code(enum rem_protocol protocol, enum remtest_case c, struct rem_code * code, uint8_t * extra, enum but_type * button);
+static void remtest_distort(struct trace * t, enum remtest_case c);
+static uint8_t remtest_report(enum rem_protocol protocol, enum remtest_case c, const struct remtest_result * r);
+static uint16_t remtest_frames();
+static void remtest_replay(struct trace * t, uint32_t period);
+static void remtest_drain(struct remtest_queue * q);
+static uint8_t remtest_check(const char * name, const struct remtest_queue * q, enum but_type type, uint16_t steps);
+static uint8_t remtest_captured();
+static uint8_t remtest_held();
+static void remtest_nec(struct trace * t, const struct rem_code * code, uint8_t repeat);
+static void remtest_costrun();
+static void remtest_edge(enum rem_protocol decoder, uint8_t mark, uint16_t length);
+static void remtest_costreport();
+
+int main() {
+	uint8_t failed = 0;
+	
+	shim_reset();
+	butinit();
+	reminit();
+	remtest_overhead = shim_clockoverhead();
+	trace_seed(REMTEST_SEED);
+	
+	printf("IR receiver, %u frames per case, seed %u, time in host %s\n",
+		REMTEST_FRAMES, REMTEST_SEED, SHIM_CLOCKUNIT);
+	printf("%-5s %-14s %7s %7s %7s %7s %9s %12s\n",
+		"proto", "case", "frames", "decoded", "dropped", "wrong", "accuracy", "time/frame");
+	
+	for(uint8_t p = 0; p < REM_NPROTOCOLS; p++) {
+		struct remtest_result warm = {0, 0, 0, 0};
+		
+		remtest_learnkeys(p);
+		for(uint16_t i = 0; i < REMTEST_WARMUP; i++) {
+			remtest_frame(p, CASE_CLEAN, &warm);
+		}
+		for(uint8_t c = 0; c < CASE_N; c++) {
+			struct remtest_result r = {0, 0, 0, 0};
+			
+			for(uint16_t i = 0; i < REMTEST_FRAMES; i++) {
+				remtest_frame(p, c, &r);
+			}
+			failed |= remtest_report(p, c, &r);
+		}
+	}
+	
+	failed |= remtest_captured();
+	failed |= remtest_held();
+	
+	printf("\nEdges input capture missed: %u%s\n", shim_missed, shim_missed ? "  FAIL" : "");
+	failed |= (shim_missed != 0);
+	
+	remtest_costrun();
+	remtest_costreport();
+	printf(failed ? "FAILED\n" : "passed\n");
+	return failed;
+}
+
+/*
+ * Restores the default keymap, then learns REMTEST_NKEYS keys of one
+ * protocol at its device address, each bound to its own button
+ */
+static void remtest_learnkeys(enum rem_protocol protocol) {
+	rem_resetkeys();
+	for(uint8_t k = 0; k < REMTEST_NKEYS; k++) {
+		uint8_t dup;
+		
+		remtest_keys[k].protocol = protocol;
+		remtest_keys[k].address = remtest_device[protocol];
+		do {							// a different command for every key
+			remtest_keys[k].command = trace_random((protocol == REM_PROTO_NEC) ? 0x100 : 0x80);
+			dup = 0;
+			for(uint8_t j = 0; j < k; j++) {
+				if(remtest_keys[j].command == remtest_keys[k].command) dup = 1;
+			}
+		} while(dup);
+		if(!rem_bind(&remtest_keys[k], remtest_buttons[k])) {
+			printf("%s: key table full\n", remtest_protocols[protocol]);
+		}
+	}
+}
+
+/*
+ * Builds one frame for a case, replays it through the Timer1 interrupts
+ * and scores what reached the button queue
+ */
+static void remtest_frame(enum rem_protocol protocol, enum remtest_case c, struct remtest_result * r) {
+	struct trace t;
+	struct rem_code code;
+	struct remtest_queue q;
+	enum but_type button;
+	uint8_t extra;
+	uint16_t frames = remtest_frames();
+	uint16_t own = rem_getframes(protocol);
+	uint64_t t0;
+	
+	remtest_code(protocol, c, &code, &extra, &button);
+	trace_build(&t, &code, extra);
+	remtest_distort(&t, c);
+	
+	t0 = shim_isrtime;
+	remtest_replay(&t, 0);
+	shim_interval(0, REMTEST_QUIET);
+	r->time += shim_isrtime - t0;
+	
+	frames = remtest_frames() - frames;
+	own = rem_getframes(protocol) - own;
+	remtest_drain(&q);
+	if(frames == 0 && q.events == 0) {
+		r->dropped++;
+	} else if(frames == 1 && own == 1
+			&& ((button == BUT_NONE && q.events == 0)
+			|| (q.events == 1 && q.type == button && q.steps == 1))) {
+		r->decoded++;
+	} else {
+		r->wrong++;
+	}
+}
+
+/*
+ * Picks a learned key for a case.  Frames go to the device's address,
+ * except in CASE_WRONGADDR, where they never do and so have no button.
+ * SIRC frames are a random length, except truncated ones: a 15 or 20-bit
+ * frame cut after 12 or 15 bits is a valid shorter frame, which no
+ * decoder could tell.
+ */
+static void remtest_code(enum rem_protocol protocol, enum remtest_case c, struct rem_code * code, uint8_t * extra, enum but_type * button) {
+	static const uint8_t sircbits[3] = {12, 15, 20};
+	static uint8_t toggle = 0;
+	uint8_t k = trace_random(REMTEST_NKEYS);
+	uint16_t mask = 0x1f;
+	
+	*code = remtest_keys[k];
+	*button = remtest_buttons[k];
+	*extra = 0;
+	switch(protocol) {
+	case REM_PROTO_SIRC:
+		*extra = (c == CASE_TRUNCATED) ? 12 : sircbits[trace_random(3)];
+		if(*extra == 15) mask = 0xff;
+		if(*extra == 20) mask = 0x1fff;
+		break;
+	case REM_PROTO_NEC:
+		mask = 0xff;
+		if(c == CASE_WRONGADDR && trace_random(2)) {	// extended address
+			mask = 0xffff;
+		}
+		break;
+	default:
+		toggle = !toggle;		// a new press each frame
+		*extra = toggle;
+		break;
+	}
+	
+	if(c == CASE_WRONGADDR) {
+		do {
+			code->address = trace_random((uint32_t)mask + 1);
+		} while(code->address == remtest_device[protocol]
+			|| (mask == 0xffff && (uint8_t)~code->address == code->address >> 8));	// that would be a standard one
+		*button = BUT_NONE;
+	}
+}
+
+static void remtest_distort(struct trace * t, enum remtest_case c) {
+	switch(c) {
+	case CASE_JITTER:
+		trace_jitter(t, 10);
+		break;
+	case CASE_HEAVYJITTER:
+		trace_jitter(t, 25);
+		break;
+	case CASE_NOISY:
+		trace_glitch(t);
+		break;
+	case CASE_TRUNCATED:
+		trace_truncate(t);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Prints a case's line and returns nonzero if it failed
+ */
+static uint8_t remtest_report(enum rem_protocol protocol, enum remtest_case c, const struct remtest_result * r) {
+	uint16_t good;
+	uint8_t failed;
+	
+	switch(remtest_cases[c].expect) {
+	case EXPECT_ALL:
+		good = r->decoded;
+		failed = (good != REMTEST_FRAMES);
+		break;
+	case EXPECT_NOWRONG:
+		good = r->decoded;
+		failed = (r->wrong != 0);
+		break;
+	default:
+		good = r->dropped;
+		failed = (good != REMTEST_FRAMES);
+		break;
+	}
+	
+	printf("%-5s %-14s %7u %7u %7u %7u %8.1f%% %12llu%s\n",
+		remtest_protocols[protocol], remtest_cases[c].name, REMTEST_FRAMES,
+		r->decoded, r->dropped, r->wrong, 100.0 * good / REMTEST_FRAMES,
+		(unsigned long long)(r->time / REMTEST_FRAMES), failed ? "  FAIL" : "");
+	return failed;
+}
+
+/*
+ * Gets the number of good frames remote.c has received, of every protocol
+ */
+static uint16_t remtest_frames() {
+	uint16_t n = 0;
+	
+	for(uint8_t p = 0; p < REM_NPROTOCOLS; p++) {
+		n += rem_getframes(p);
+	}
+	return n;
+}
+
+/*
+ * Plays a trace on the receiver output.  With a nonzero period, the
+ * silence before the frame is set so frames start period apart.
+ */
+static void remtest_replay(struct trace * t, uint32_t period) {
+	uint32_t length = 0;
+	
+	for(uint8_t i = 1; i < t->n; i++) {
+		length += t->edges[i].length;
+	}
+	shim_interval(t->edges[0].mark, period ? period - length : t->edges[0].length);
+	for(uint8_t i = 1; i < t->n; i++) {
+		shim_interval(t->edges[i].mark, t->edges[i].length);
+	}
+}
+
+/*
+ * Empties the button queue, noting what was in it
+ */
+static void remtest_drain(struct remtest_queue * q) {
+	enum but_type type;
+	uint8_t steps;
+	
+	q->events = q->others = 0;
+	q->type = BUT_NONE;
+	q->steps = 0;
+	while((type = but_popn(&steps)) != BUT_NONE) {
+		if(q->events++ == 0) q->type = type;
+		if(type == q->type) {
+			q->steps += steps;
+		} else {
+			q->others++;
+		}
+	}
+}
+
+/*
+ * Prints a check's line and returns nonzero if the queue did not hold
+ * steps steps of type and nothing else
+ */
+static uint8_t remtest_check(const char * name, const struct remtest_queue * q, enum but_type type, uint16_t steps) {
+	uint8_t failed = (q->type != type || q->steps != steps || q->others != 0);
+	
+	printf("%-34s %5u %5u %6u%s\n", name, steps, q->type == type ? q->steps : 0, q->others,
+		failed ? "  FAIL" : "");
+	return failed;
+}
+
+/*
+ * Replays each capture file with its key learned.  Each must queue its
+ * button once.
+ */
+static uint8_t remtest_captured() {
+	uint8_t failed = 0;
+	
+	printf("\n%-34s %5s %5s %6s\n", "Capture", "steps", "got", "others");
+	for(uint8_t i = 0; i < REMTEST_NCAPTURES; i++) {
+		struct trace t;
+		struct remtest_queue q;
+		
+		if(!trace_load(&t, remtest_captures[i].path)) {
+			printf("%-34s can't read%s\n", remtest_captures[i].path, "  FAIL");
+			failed = 1;
+			continue;
+		}
+		rem_resetkeys();
+		rem_bind(&remtest_captures[i].code, remtest_captures[i].button);
+		remtest_replay(&t, 0);
+		shim_interval(0, REMTEST_QUIET);
+		remtest_drain(&q);
+		failed |= remtest_check(remtest_captures[i].path, &q, remtest_captures[i].button, 1);
+	}
+	return failed;
+}
+
+/*
+ * Holds keys down, presses them twice and learns one, checking the steps
+ * auto-repeat and the keymap queue.  Frames repeat at each protocol's
+ * own rate: SIRC every 45 ms, NEC every 108 ms and RC5 every 114 ms.  The
+ * NEC and RC5 gaps outlast the silence timeout, so the key is only held
+ * because remote.c waits another timer period before releasing it.
+ */
+static uint8_t remtest_held() {
+	static const struct rem_code sircvol = {REM_PROTO_SIRC, 1, 0x12};	// default keymap: volume up
+	static const struct rem_code sircenter = {REM_PROTO_SIRC, 1, 0x60};	// default keymap: enter
+	static const struct rem_code necvol = {REM_PROTO_NEC, 0x04, 0x03};
+	static const struct rem_code rc5vol = {REM_PROTO_RC5, 0x00, 0x11};
+	static const struct rem_code neclearn = {REM_PROTO_NEC, 0x1234, 0x40};
+	struct trace t;
+	struct rem_code learned;
+	struct remtest_queue q;
+	uint8_t failed = 0;
+	
+	printf("\n%-34s %5s %5s %6s\n", "Key", "steps", "got", "others");
+	rem_resetkeys();
+	rem_bind(&necvol, BUT_VOLDEC);
+	rem_bind(&rc5vol, BUT_VOLINC);
+	
+	trace_build(&t, &sircvol, 12);
+	for(uint8_t i = 0; i < REMTEST_HELD; i++) remtest_replay(&t, 45000);
+	shim_interval(0, REMTEST_QUIET);
+	remtest_drain(&q);
+	failed |= remtest_check("SIRC volume held", &q, BUT_VOLINC, REMTEST_HELDSTEPS);
+	
+	trace_build(&t, &sircenter, 12);
+	for(uint8_t i = 0; i < REMTEST_HELD; i++) remtest_replay(&t, 45000);
+	shim_interval(0, REMTEST_QUIET);
+	remtest_drain(&q);
+	failed |= remtest_check("SIRC enter held", &q, BUT_ENTER, 1);
+	
+	for(uint8_t press = 0; press < 2; press++) {	// released by the silence in between
+		for(uint8_t i = 0; i < 3; i++) remtest_replay(&t, 45000);
+		shim_interval(0, REMTEST_QUIET);
+	}
+	remtest_drain(&q);
+	failed |= remtest_check("SIRC enter pressed twice", &q, BUT_ENTER, 2);
+	
+	remtest_nec(&t, &necvol, 0);
+	remtest_replay(&t, 108000);
+	remtest_nec(&t, &necvol, 1);
+	for(uint8_t i = 1; i < REMTEST_HELD; i++) remtest_replay(&t, 108000);
+	shim_interval(0, REMTEST_QUIET);
+	remtest_drain(&q);
+	failed |= remtest_check("NEC volume held (repeat codes)", &q, BUT_VOLDEC, REMTEST_HELDSTEPS);
+	
+	trace_build(&t, &rc5vol, 1);
+	for(uint8_t i = 0; i < REMTEST_HELD; i++) remtest_replay(&t, 114000);
+	shim_interval(0, REMTEST_QUIET);
+	remtest_drain(&q);
+	failed |= remtest_check("RC5 volume held", &q, BUT_VOLINC, REMTEST_HELDSTEPS);
+	
+	rem_learn();
+	remtest_nec(&t, &neclearn, 0);
+	remtest_replay(&t, 108000);
+	remtest_nec(&t, &neclearn, 1);
+	for(uint8_t i = 1; i < REMTEST_HELD; i++) remtest_replay(&t, 108000);
+	shim_interval(0, REMTEST_QUIET);
+	remtest_drain(&q);
+	if(!rem_getlearned(&learned) || learned.protocol != neclearn.protocol
+			|| learned.address != neclearn.address || learned.command != neclearn.command) {
+		q.others++;				// reported as a failure below
+	}
+	failed |= remtest_check("NEC key learned, not queued", &q, BUT_NONE, 0);
+	
+	return failed;
+}
+
+/*
+ * Builds an NEC frame, or the repeat code sent while its key is held
+ */
+static void remtest_nec(struct trace * t, const struct rem_code * code, uint8_t repeat) {
+	trace_build(t, code, 0);
+	if(repeat) {
+		t->n = 4;					// silence, header mark, short space, stop mark
+		t->edges[2].length = 2250;
+	}
+}
+
+/*
+ * Runs every case again straight through the decoders, timing each
+ * decoder's xxx_edge() on its own.  The decoders report to remote.c as
+ * usual; what they queue is thrown away.
+ */
+static void remtest_costrun() {
+	struct remtest_queue q;
+	
+	trace_seed(REMTEST_SEED);
+	for(uint8_t p = 0; p < REM_NPROTOCOLS; p++) {
+		remtest_learnkeys(p);
+		for(uint8_t c = 0; c < CASE_N; c++) {
+			for(uint16_t i = 0; i < REMTEST_FRAMES; i++) {
+				struct trace t;
+				struct rem_code code;
+				enum but_type button;
+				uint8_t extra;
+				
+				remtest_code(p, c, &code, &extra, &button);
+				trace_build(&t, &code, extra);
+				remtest_distort(&t, c);
+				for(uint8_t e = 0; e < t.n; e++) {
+					for(uint8_t d = 0; d < REM_NPROTOCOLS; d++) {
+						remtest_edge(d, t.edges[e].mark, t.edges[e].length);
+					}
+				}
+				sirc_idle();			// the line goes quiet
+				nec_idle();
+				rc5_idle();
+				remtest_drain(&q);
+			}
+		}
+	}
+}
+
+/*
+ * Runs one decoder on one edge and adds the time it took to its cost
+ */
+static void remtest_edge(enum rem_protocol decoder, uint8_t mark, uint16_t length) {
+	uint64_t t0 = shim_clock();
+	uint64_t dt;
+	
+	remtest_decoders[decoder](mark, length);
+	dt = shim_clock() - t0;
+	dt = (dt > remtest_overhead) ? dt - remtest_overhead : 0;
+	remtest_cost[decoder].edges++;
+	remtest_cost[decoder].time += dt;
+	remtest_cost[decoder].hist[(dt < REMTEST_HISTLEN) ? dt : REMTEST_HISTLEN - 1]++;
+}
+
+/*
+ * Prints each decoder's mean, median and 99th percentile time per edge.
+ * The percentiles leave out the host's own interruptions, which a
+ * maximum would report instead.
+ */
+static void remtest_costreport() {
+	printf("\nPer edge, every case, time in host %s\n", SHIM_CLOCKUNIT);
+	printf("%-7s %8s %7s %7s %7s\n", "decoder", "edges", "mean", "median", "99%");
+	for(uint8_t d = 0; d < REM_NPROTOCOLS; d++) {
+		uint32_t seen = 0;
+		uint16_t median = REMTEST_HISTLEN, p99 = REMTEST_HISTLEN;	// not reached yet
+		
+		for(uint16_t i = 0; i < REMTEST_HISTLEN; i++) {
+			seen += remtest_cost[d].hist[i];
+			if(median == REMTEST_HISTLEN && seen * 2ULL >= remtest_cost[d].edges) median = i;
+			if(p99 == REMTEST_HISTLEN && seen * 100ULL >= remtest_cost[d].edges * 99ULL) p99 = i;
+		}
+		printf("%-7s %8u %7.1f %7u %7u\n", remtest_protocols[d], remtest_cost[d].edges,
+			remtest_cost[d].edges ? (double)remtest_cost[d].time / remtest_cost[d].edges : 0.0,
+			median, p99);
+	}
+}
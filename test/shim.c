@@ -0,0 +1,127 @@
+/*
+ * shim.c - Host stand-ins for the IR receiver's hardware
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <avr/io.h>
+#include "shim.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define SHIM_START 0xf000	// timer count at reset, a little before it wraps
+
+volatile uint8_t DDRB, PORTB;
+volatile uint8_t DDRC, PORTC, PINC = 0xff;	// buttons up, encoders at rest
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, ICR1, OCR1A;
+
+uint32_t shim_missed = 0;
+uint64_t shim_isrtime = 0;
+
+static uint32_t shim_now = SHIM_START;	// microseconds, one timer count each at 1 MHz
+static uint8_t shim_level = 0;			// the receiver output: nonzero during a mark
+static uint64_t shim_overhead;			// host time of reading the host clock
+
+static void shim_advance(uint32_t length);
+static void shim_isr(void (* isr)(void));
+
+void shim_reset() {
+	shim_now = SHIM_START;
+	TCNT1 = shim_now;
+	shim_level = 0;
+	shim_missed = 0;
+	shim_isrtime = 0;
+	shim_overhead = shim_clockoverhead();
+}
+
+/*
+ * The receiver output is active-low, so the end of a mark is a rising
+ * edge, which input capture takes only with ICES1 set.
+ */
+void shim_interval(uint8_t mark, uint32_t length) {
+	mark = (mark != 0);
+	if(mark != shim_level) {
+		uint8_t rising = shim_level;
+		
+		shim_level = mark;
+		if(TIMSK1 & (1<<ICIE1)) {
+			if(!(TCCR1B & (1<<ICES1)) == !rising) {
+				ICR1 = shim_now;
+				shim_isr(TIMER1_CAPT_vect);
+			} else {
+				shim_missed++;
+			}
+		}
+	}
+	shim_advance(length);
+}
+
+/*
+ * Runs the clock forward, raising the compare match interrupt each time
+ * the count passes OCR1A while it is enabled
+ */
+static void shim_advance(uint32_t length) {
+	uint32_t end = shim_now + length;
+	
+	while(TIMSK1 & (1<<OCIE1A)) {
+		uint32_t match = (uint16_t)(OCR1A - shim_now);
+		
+		if(match == 0) match = 0x10000;	// fired here already: next time round
+		if(shim_now + match > end) break;
+		shim_now += match;
+		TCNT1 = shim_now;
+		shim_isr(TIMER1_COMPA_vect);
+	}
+	shim_now = end;
+	TCNT1 = shim_now;
+}
+
+static void shim_isr(void (* isr)(void)) {
+	uint64_t t0 = shim_clock();
+	uint64_t dt;
+	
+	isr();
+	dt = shim_clock() - t0;
+	if(dt > shim_overhead) shim_isrtime += dt - shim_overhead;
+}
+
+uint64_t shim_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+uint64_t shim_clockoverhead() {
+	uint64_t best = UINT64_MAX;
+	
+	for(uint16_t i = 0; i < 1000; i++) {
+		uint64_t t0 = shim_clock();
+		uint64_t t1 = shim_clock();
+		
+		if(t1 - t0 < best) best = t1 - t0;
+	}
+	return best;
+}
@@ -0,0 +1,63 @@
+/*
+ * shim.h - Host stand-ins for the IR receiver's hardware
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * On the board, Timer1 timestamps receiver edges by input capture and
+ * raises TIMER1_COMPA_vect when the line has been quiet.  Here shim.c
+ * keeps a microsecond clock in its place: the test describes the receiver
+ * output as intervals of mark and space, and the shim raises the real
+ * interrupt handlers from remote.c at the edges and timeouts they fall
+ * on, as the timer would.  A host clock times the handlers.
+ */
+
+#ifndef SHIM_H_
+#define SHIM_H_
+
+#include <stdint.h>
+
+// Timer1's interrupt handlers, from remote.c
+void TIMER1_CAPT_vect(void);
+void TIMER1_COMPA_vect(void);
+
+// edges input capture missed, because ICES1 selected the other edge
+extern uint32_t shim_missed;
+
+// host time spent in the Timer1 interrupt handlers, in SHIM_CLOCKUNIT
+extern uint64_t shim_isrtime;
+
+/* puts the line at rest, with the timer just short of wrapping so the
+   first frames straddle it */
+void shim_reset();
+
+/* holds the receiver output at one level for length microseconds: a mark
+   (IR burst) if mark is nonzero, otherwise a space.  The edge into that
+   level, if it is a change, is offered to input capture first. */
+void shim_interval(uint8_t mark, uint32_t length);
+
+// reads the host clock, in SHIM_CLOCKUNIT
+uint64_t shim_clock();
+
+// the smallest difference between two back-to-back shim_clock() reads
+uint64_t shim_clockoverhead();
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHIM_CLOCKUNIT "cycles"
+#else
+#define SHIM_CLOCKUNIT "ns"
+#endif
+
+#endif /* SHIM_H_ */
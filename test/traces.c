@@ -0,0 +1,205 @@
+/*
+ * traces.c - IR receiver traces for the decoder tests
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * Timings are the nominal ones from each decoder's header comment.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "remote.h"
+#include "traces.h"
+
+#define SIRC_HEADER 2400
+#define SIRC_UNIT 600
+#define NEC_HEADER 9000
+#define NEC_HEADERSPACE 4500
+#define NEC_UNIT 560
+#define NEC_ONESPACE 1690
+#define RC5_HALFBIT 889
+
+static uint32_t trace_state = 1;
+
+static void trace_add(struct trace * t, uint8_t mark, uint16_t length);
+static void trace_sirc(struct trace * t, const struct rem_code * code, uint8_t bits);
+static void trace_nec(struct trace * t, const struct rem_code * code);
+static void trace_rc5(struct trace * t, const struct rem_code * code, uint8_t toggle);
+
+void trace_seed(uint32_t seed) {
+	trace_state = seed ? seed : 1;
+}
+
+/*
+ * xorshift32, so a run is the same on every host
+ */
+uint32_t trace_random(uint32_t n) {
+	trace_state ^= trace_state << 13;
+	trace_state ^= trace_state >> 17;
+	trace_state ^= trace_state << 5;
+	return n ? trace_state % n : 0;
+}
+
+void trace_build(struct trace * t, const struct rem_code * code, uint8_t extra) {
+	t->n = 0;
+	trace_add(t, 0, TRACE_SILENCE);
+	switch(code->protocol) {
+	case REM_PROTO_SIRC:
+		trace_sirc(t, code, extra);
+		break;
+	case REM_PROTO_NEC:
+		trace_nec(t, code);
+		break;
+	default:
+		trace_rc5(t, code, extra);
+		break;
+	}
+}
+
+void trace_jitter(struct trace * t, uint8_t percent) {
+	for(uint8_t i = 1; i < t->n; i++) {	// not the silence before the frame
+		int32_t change = (int32_t)trace_random(2 * percent + 1) - percent;
+		
+		t->edges[i].length = (int32_t)t->edges[i].length * (100 + change) / 100;
+	}
+}
+
+void trace_glitch(struct trace * t) {
+	uint8_t i;
+	uint16_t length, before, glitch;
+	
+	if(t->n + 2 > TRACE_MAXEDGES) return;
+	do {
+		i = 1 + trace_random(t->n - 1);
+	} while(t->edges[i].length < 400);
+	
+	length = t->edges[i].length;
+	glitch = 50 + trace_random(100);
+	before = 100 + trace_random(length - glitch - 200);
+	for(uint8_t j = t->n - 1; j > i; j--) {
+		t->edges[j + 2] = t->edges[j];
+	}
+	t->n += 2;
+	t->edges[i].length = before;
+	t->edges[i + 1].mark = !t->edges[i].mark;
+	t->edges[i + 1].length = glitch;
+	t->edges[i + 2].mark = t->edges[i].mark;
+	t->edges[i + 2].length = length - before - glitch;
+}
+
+void trace_truncate(struct trace * t) {
+	t->n = 2 + trace_random(t->n - 3);	// at least the first mark, never the last two edges
+}
+
+/*
+ * Keeps each line's interval as it is, so long silences aren't merged
+ * past what a length holds
+ */
+uint8_t trace_load(struct trace * t, const char * path) {
+	char line[80];
+	unsigned mark, length;
+	FILE * f = fopen(path, "r");
+	
+	if(f == NULL) return 0;
+	t->n = 0;
+	while(fgets(line, sizeof(line), f) != NULL) {
+		if(line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+		if(sscanf(line, "%u %u", &mark, &length) != 2 || mark > 1 || length > 0xffff
+				|| t->n == TRACE_MAXEDGES) {
+			fclose(f);
+			return 0;
+		}
+		t->edges[t->n].mark = mark;
+		t->edges[t->n].length = length;
+		t->n++;
+	}
+	fclose(f);
+	return t->n != 0;
+}
+
+/*
+ * Appends an interval, merging it into the last one if they are the same
+ * kind
+ */
+static void trace_add(struct trace * t, uint8_t mark, uint16_t length) {
+	if(t->n != 0 && t->edges[t->n - 1].mark == mark) {
+		t->edges[t->n - 1].length += length;
+	} else if(t->n < TRACE_MAXEDGES) {
+		t->edges[t->n].mark = mark;
+		t->edges[t->n].length = length;
+		t->n++;
+	}
+}
+
+/*
+ * Header mark, then per bit a space and a one- or two-unit mark, LSB
+ * first: command, then address
+ */
+static void trace_sirc(struct trace * t, const struct rem_code * code, uint8_t bits) {
+	uint32_t packet = code->command | ((uint32_t)code->address << 7);
+	
+	trace_add(t, 1, SIRC_HEADER);
+	for(uint8_t i = 0; i < bits; i++) {
+		trace_add(t, 0, SIRC_UNIT);
+		trace_add(t, 1, (packet & 1) ? 2 * SIRC_UNIT : SIRC_UNIT);
+		packet >>= 1;
+	}
+}
+
+/*
+ * Header, 32 bits LSB first as a mark and a short or long space, then
+ * the stop mark.  Addresses above 255 are sent extended.
+ */
+static void trace_nec(struct trace * t, const struct rem_code * code) {
+	uint32_t packet;
+	
+	if(code->address > 0xff) {
+		packet = code->address;
+	} else {
+		packet = code->address | ((uint32_t)(uint8_t)~code->address << 8);
+	}
+	packet |= ((uint32_t)code->command << 16) | ((uint32_t)(uint8_t)~code->command << 24);
+	
+	trace_add(t, 1, NEC_HEADER);
+	trace_add(t, 0, NEC_HEADERSPACE);
+	for(uint8_t i = 0; i < 32; i++) {
+		trace_add(t, 1, NEC_UNIT);
+		trace_add(t, 0, (packet & 1) ? NEC_ONESPACE : NEC_UNIT);
+		packet >>= 1;
+	}
+	trace_add(t, 1, NEC_UNIT);
+}
+
+/*
+ * 14 Manchester bits, MSB first.  The first half of the first start bit
+ * is silence, and a trailing space half belongs to the silence after.
+ */
+static void trace_rc5(struct trace * t, const struct rem_code * code, uint8_t toggle) {
+	uint16_t packet = 1 << 13;
+	
+	if(!(code->command & 0x40)) packet |= 1 << 12;	// RC5X: second start bit is inverted command bit 6
+	if(toggle) packet |= 1 << 11;
+	packet |= (code->address & 0x1f) << 6;
+	packet |= code->command & 0x3f;
+	
+	for(int8_t i = 13; i >= 0; i--) {
+		uint8_t one = (packet >> i) & 1;
+		
+		trace_add(t, !one, RC5_HALFBIT);
+		trace_add(t, one, RC5_HALFBIT);
+	}
+	if(!t->edges[t->n - 1].mark) t->n--;
+}
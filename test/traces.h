@@ -0,0 +1,73 @@
+/*
+ * traces.h - IR receiver traces for the decoder tests
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * A trace is the receiver output over one or more frames: a list of
+ * (mark, length) edges, each the kind and length of an interval, as
+ * remote.c hands them to the decoders.  It starts with the silence before
+ * the first frame and ends with the last mark; the silence after it is
+ * left to the test.  Traces are either built from the protocol timings,
+ * then optionally distorted, or loaded from a capture file.
+ *
+ * A capture file is text, one interval per line: 1 for a mark or 0 for a
+ * space, then its length in microseconds.  Blank lines and lines starting
+ * with # are ignored.  Intervals of the same kind in a row are one longer
+ * interval, so a silence longer than 65535 us can be split over lines.
+ */
+
+#ifndef TRACES_H_
+#define TRACES_H_
+
+#include <stdint.h>
+#include "remote.h"
+
+#define TRACE_MAXEDGES 255
+#define TRACE_SILENCE 30000		// microseconds of quiet before each frame
+
+struct trace_edge {
+	uint8_t mark;		// nonzero if the interval was IR burst
+	uint16_t length;	// microseconds
+};
+
+struct trace {
+	struct trace_edge edges[TRACE_MAXEDGES];
+	uint8_t n;
+};
+
+// seeds the generator behind the random frames and distortions
+void trace_seed(uint32_t seed);
+
+// a random number below n
+uint32_t trace_random(uint32_t n);
+
+/* builds the trace of one frame.  SIRC takes the frame length in bits
+   (12, 15 or 20) and RC5 the toggle bit in extra; NEC ignores it. */
+void trace_build(struct trace * t, const struct rem_code * code, uint8_t extra);
+
+// stretches or shrinks every interval by a random amount up to percent
+void trace_jitter(struct trace * t, uint8_t percent);
+
+// splits one interval of the frame with a short glitch of the other kind
+void trace_glitch(struct trace * t);
+
+// cuts the frame short before its last bit is complete
+void trace_truncate(struct trace * t);
+
+// reads a capture file; returns nonzero on success
+uint8_t trace_load(struct trace * t, const char * path);
+
+#endif /* TRACES_H_ */
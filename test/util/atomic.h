@@ -0,0 +1,29 @@
+/*
+ * util/atomic.h - Host stand-in for avr-libc's atomic blocks
+ * Copyright (C) 2014 Ali Kocaturk <akfrnswrth@gmail.com>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * The host replays one interrupt at a time, so a block only has to run
+ * its body once.
+ */
+
+#ifndef SHIM_UTIL_ATOMIC_H_
+#define SHIM_UTIL_ATOMIC_H_
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_BLOCK(type) for(uint8_t shim_atomic = 1; shim_atomic; shim_atomic = 0)
+
+#endif /* SHIM_UTIL_ATOMIC_H_ */